@@ -0,0 +1,319 @@
+/*
+ * Host benchmark for the kernel heaps. Built by "make bench" with the host
+ * compiler: lib/mem.c and lib/buddy.c are compiled unchanged and get their
+ * memory from the kmalloc() stub below.
+ *
+ *	usage: bench mcb|buddy [label [seed]]
+ *
+ * Every workload runs the same seeded sequence of requests against a fresh
+ * heap of HEAP_SIZE bytes, the size kmain gives the kernel heap. Latency is
+ * measured per call with CLOCK_MONOTONIC, less the measured cost of reading
+ * the clock, and ops/s is derived from the summed per-call time.
+ */
+#define _POSIX_C_SOURCE 200112L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/memory.h"
+#include "../include/buddy.h"
+#include "../include/pcb.h"
+
+#define HEAP_SIZE	0x400000
+#define OPS		1000000
+#define MAX_LIVE	4096
+#define SAMPLES		8
+
+void *kmalloc(size_t size, int align, void **phys_addr)
+{
+	void *p = NULL;
+
+	(void)align;
+	(void)phys_addr;
+	if (posix_memalign(&p, 4096, (size + 4095) & ~(size_t)4095) != 0) {
+		return NULL;
+	}
+	return p;
+}
+
+static void *(*heap_alloc)(size_t);
+static int (*heap_free)(void *);
+static int use_buddy;
+
+static uint64_t rng;
+
+static uint32_t rnd(void)
+{
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return (uint32_t)(rng >> 32);
+}
+
+static size_t between(size_t lo, size_t hi)
+{
+	return lo + rnd() % (hi - lo + 1);
+}
+
+static uint64_t now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+}
+
+struct slot {
+	void *p;
+	size_t sz;
+};
+
+static struct slot live[MAX_LIVE];
+static int nlive;
+static int head;			// oldest slot, for FIFO workloads
+static uint32_t lat[OPS];		// per-call latency, ns
+static int nlat;
+static uint64_t clock_cost;
+static int failures;
+
+struct sample {
+	int frag;
+	int free_blocks;
+};
+static struct sample samples[SAMPLES];
+
+static void record(uint64_t t0, uint64_t t1)
+{
+	uint64_t d = t1 - t0;
+	d = d > clock_cost ? d - clock_cost : 0;
+	lat[nlat++] = d > UINT32_MAX ? UINT32_MAX : (uint32_t)d;
+}
+
+/* Allocates into slot i; the block is written so it is really used */
+static void do_alloc(int i, size_t sz)
+{
+	uint64_t t0 = now();
+	void *p = heap_alloc(sz);
+	record(t0, now());
+
+	if (p == NULL) {
+		failures++;
+		live[i].p = NULL;
+		return;
+	}
+	memset(p, 0xA5, sz < 64 ? sz : 64);
+	live[i].p = p;
+	live[i].sz = sz;
+}
+
+static void do_free(int i)
+{
+	if (live[i].p == NULL) {
+		return;
+	}
+	uint64_t t0 = now();
+	heap_free(live[i].p);
+	record(t0, now());
+	live[i].p = NULL;
+}
+
+/* Frees a random live block, keeping the live set packed */
+static void free_random(void)
+{
+	int i = rnd() % nlive;
+	do_free(i);
+	live[i] = live[--nlive];
+}
+
+static void alloc_push(size_t sz)
+{
+	do_alloc(nlive, sz);
+	if (live[nlive].p != NULL) {
+		nlive++;
+	}
+}
+
+/* Random alloc/free mix over a bounded live set */
+static void mix(size_t (*size)(void))
+{
+	if (nlive > 0 && (nlive == MAX_LIVE || rnd() % 2)) {
+		free_random();
+	} else {
+		alloc_push(size());
+	}
+}
+
+static size_t uniform_size(void)
+{
+	return between(8, 256);
+}
+
+static size_t pcb_size(void)
+{
+	return PCB_ALIGN;	// a struct pcb: one cache line on i386, not sizeof on the host
+}
+
+static size_t bimodal_size(void)
+{
+	return rnd() % 10 ? between(16, 64) : between(2048, 8192);
+}
+
+static void uniform(void)
+{
+	mix(uniform_size);
+}
+
+static void pcb(void)
+{
+	mix(pcb_size);
+}
+
+static void bimodal(void)
+{
+	mix(bimodal_size);
+}
+
+/* Oldest block freed first, with the queue length drifting up and down */
+static void prodcons(void)
+{
+	int queued = (nlive - head + MAX_LIVE) % MAX_LIVE;
+
+	if (queued > 0 && (queued == MAX_LIVE - 1 || (int)(rnd() % 100) < 48 + queued / 64)) {
+		do_free(head);
+		head = (head + 1) % MAX_LIVE;
+	} else {
+		do_alloc(nlive, between(32, 512));
+		if (live[nlive].p != NULL) {
+			nlive = (nlive + 1) % MAX_LIVE;
+		}
+	}
+}
+
+/* Fill to 2048 live blocks, or until the heap is full, then free them all in random order */
+static int draining;
+static int seen_failures;
+
+static void randfree(void)
+{
+	if (draining && nlive == 0) {
+		draining = 0;
+	} else if (!draining && (nlive == 2048 || failures != seen_failures)) {
+		draining = nlive > 0;
+		seen_failures = failures;
+	}
+	if (draining) {
+		free_random();
+	} else {
+		alloc_push(between(16, 1024));
+	}
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+	return x < y ? -1 : x > y;
+}
+
+static void sample(int n)
+{
+	struct heap_stats st;
+
+	if (use_buddy || heap_get_stats(&st) != 0) {
+		samples[n].frag = samples[n].free_blocks = -1;
+		return;
+	}
+	samples[n].free_blocks = (int)st.free_blocks;
+	samples[n].frag = st.free ? (int)((st.free - st.largest_free) * 100 / st.free) : 0;
+}
+
+static void run(const char *name, void (*step)(void))
+{
+	if ((use_buddy ? buddy_init(HEAP_SIZE) : initialize_heap(HEAP_SIZE)) != 0) {
+		fprintf(stderr, "cannot create a %d byte heap\n", HEAP_SIZE);
+		exit(1);
+	}
+	memset(live, 0, sizeof(live));
+	nlive = head = nlat = failures = 0;
+	draining = seen_failures = 0;
+
+	for (int i = 0; i < OPS; i++) {
+		step();
+		if ((i + 1) % (OPS / SAMPLES) == 0) {
+			sample(i / (OPS / SAMPLES));
+		}
+	}
+
+	uint64_t total = 0;
+	for (int i = 0; i < nlat; i++) {
+		total += lat[i];
+	}
+	qsort(lat, nlat, sizeof(lat[0]), cmp_u32);
+
+	printf("%-10s %8d %10.0f %6u %6u %6u %7u %8u %6d\n", name, nlat,
+	       total ? nlat * 1e9 / total : 0.0,
+	       lat[nlat / 2], lat[nlat * 9 / 10], lat[nlat * 99 / 100],
+	       lat[nlat * 999 / 1000], lat[nlat - 1], failures);
+
+	printf("%-10s frag%%:", "");
+	for (int i = 0; i < SAMPLES; i++) {
+		if (samples[i].frag < 0) {
+			printf("    -");
+		} else {
+			printf(" %4d", samples[i].frag);
+		}
+	}
+	printf("   free blocks:");
+	for (int i = 0; i < SAMPLES; i++) {
+		if (samples[i].free_blocks < 0) {
+			printf("    -");
+		} else {
+			printf(" %4d", samples[i].free_blocks);
+		}
+	}
+	printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc < 2 || (strcmp(argv[1], "mcb") && strcmp(argv[1], "buddy"))) {
+		fprintf(stderr, "usage: %s mcb|buddy [label [seed]]\n", argv[0]);
+		return 2;
+	}
+	use_buddy = !strcmp(argv[1], "buddy");
+	heap_alloc = use_buddy ? buddy_alloc : allocate_memory;
+	heap_free = use_buddy ? buddy_free : free_memory;
+	uint64_t seed = argc > 3 ? strtoull(argv[3], NULL, 0) : 88172645463325252ull;
+
+	// what two back-to-back clock reads cost, subtracted from every sample
+	uint64_t best = UINT64_MAX;
+	for (int i = 0; i < 1000; i++) {
+		uint64_t t0 = now(), t1 = now();
+		if (t1 - t0 < best) {
+			best = t1 - t0;
+		}
+	}
+	clock_cost = best;
+
+	printf("heap: %s, seed %llu, %d ops per workload, clock cost %llu ns\n",
+	       argc > 2 ? argv[2] : argv[1], (unsigned long long)seed, OPS,
+	       (unsigned long long)clock_cost);
+	printf("%-10s %8s %10s %6s %6s %6s %7s %8s %6s\n", "workload", "ops",
+	       "ops/s", "p50", "p90", "p99", "p99.9", "max(ns)", "fails");
+
+	static const struct {
+		const char *name;
+		void (*step)(void);
+	} workloads[] = {
+		{ "uniform", uniform },
+		{ "pcb", pcb },
+		{ "bimodal", bimodal },
+		{ "prodcons", prodcons },
+		{ "randfree", randfree },
+	};
+	for (size_t i = 0; i < sizeof(workloads) / sizeof(workloads[0]); i++) {
+		rng = seed;
+		run(workloads[i].name, workloads[i].step);
+	}
+	return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef MPX_BUDDY_H
+#define MPX_BUDDY_H
+
+#include <stddef.h>
+
+/**
+ @file buddy.h
+ @brief Binary buddy heap, an alternative to the MCB heap in memory.h
+
+ Every block is a power of two in size, from BUDDY_MIN_SIZE up to the whole
+ pool, and is aligned to its own size relative to the pool base. Splitting
+ and merging take at most one step per order, so allocation and release
+ are O(log n) in the pool size. Blocks of a page or more are page aligned.
+*/
+
+/** Smallest block handed out; smaller requests are rounded up to it */
+#define BUDDY_MIN_SIZE 32
+
+/**
+ Creates the buddy pool from the kernel heap.
+ @param sz Pool size in bytes; rounded down to a power of two
+ @return 0 on success, -1 if the memory could not be allocated
+*/
+int buddy_init(size_t sz);
+
+/**
+ Allocates the smallest block that holds sz bytes.
+ @param sz The number of bytes required
+ @return NULL if no block is large enough, otherwise the block
+*/
+void *buddy_alloc(size_t sz);
+
+/**
+ Releases a block and merges it with its free buddies.
+ @param ptr A block returned by buddy_alloc()
+ @return 0 on success, -1 if ptr is not an allocated block
+*/
+int buddy_free(void *ptr);
+
+#endif
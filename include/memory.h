@@ -29,12 +29,102 @@ int sys_free_mem(void *ptr);
 */
 void sys_set_heap_functions(void * (*alloc_fn)(size_t), int (*free_fn)(void *));
 
-void initialize_heap(size_t sz);
+/**
+ Creates the MCB heap from the kernel heap.
+ @param sz Heap size in bytes
+ @return 0 on success, -1 if the memory could not be allocated
+*/
+int initialize_heap(size_t sz);
 void *allocate_memory(size_t sz);
 int free_memory(void *ptr);
 
+/**
+ Allocates zeroed memory for an array. Blocks known to be clean are not
+ cleared again.
+ @param nmemb The number of elements
+ @param sz The size of each element
+ @return NULL on error or overflow, otherwise the zeroed memory
+*/
+void *allocate_zeroed_memory(size_t nmemb, size_t sz);
+
+/**
+ Allocates memory whose address is a multiple of align. The slack in front
+ of the aligned address goes back to the heap, so even page alignment does
+ not waste a page.
+ @param align The alignment in bytes; must be a power of two
+ @param sz The amount of memory, in bytes, to allocate
+ @return NULL on error, otherwise the aligned memory; free it with free_memory()
+*/
+void *allocate_aligned_memory(size_t align, size_t sz);
+
+/**
+ Resizes an allocation, growing in place into a following free block when
+ possible and moving the contents otherwise.
+ @param ptr Memory from allocate_memory(), or NULL to allocate
+ @param sz The new size; 0 frees ptr
+ @return NULL on error (ptr is left untouched), otherwise the memory
+*/
+void *reallocate_memory(void *ptr, size_t sz);
+
+/** Heap statistics, as reported by heap_get_stats() */
+struct heap_stats {
+	size_t total;		/** Payload bytes in all blocks */
+	size_t free;		/** Payload bytes in free blocks */
+	size_t allocated;	/** Payload bytes in allocated blocks */
+	size_t largest_free;	/** Size of the largest free block */
+	size_t free_blocks;	/** Number of free blocks */
+	size_t allocs;		/** Allocations handed out since boot */
+	size_t frees;		/** Successful free_memory() calls since boot */
+	size_t peak;		/** Most payload bytes ever allocated at once */
+};
+
+/**
+ Walks the MCB heap and collects its statistics.
+ @param stats Filled with the current statistics
+ @return 0 on success, -1 if the heap has not been initialized
+*/
+int heap_get_stats(struct heap_stats *stats);
+
+/** One allocation site, as recorded by the heap profiler */
+struct heap_site {
+	void *caller;		/** Return address of the allocating call */
+	int owner;		/** PID that was running, or 0 for the kernel */
+	size_t live_bytes;	/** Payload bytes of its blocks still allocated */
+	size_t live_blocks;	/** Its blocks still allocated */
+	size_t allocs;		/** Blocks it allocated while profiling was on */
+};
+
+/**
+ Turns the allocation profiler on or off. Turning it on discards earlier
+ results; blocks recorded before it was turned off are still tracked
+ until they are freed.
+ @param on Non-zero to record allocations
+*/
+void heap_profile_enable(int on);
+
+/**
+ Attributes the next allocation to caller instead of the immediate caller
+ of the heap, for front ends such as sys_alloc_mem().
+ @param caller A return address, or NULL
+*/
+void heap_profile_caller(void *caller);
+
+/**
+ Sets how the profiler learns who owns an allocation.
+ @param owner Returns the PID of the running process, or 0
+*/
+void heap_profile_owner(int (*owner)(void));
+
+/**
+ @param count Receives the number of sites
+ @param dropped Receives the number of allocations that did not fit in
+        the profiler's tables
+ @return The recorded allocation sites
+*/
+const struct heap_site *heap_profile_sites(int *count, size_t *dropped);
+
 struct mcb {
-	size_t size;    // LSB ? FREE : ALLOC; LSB2 ? END : NOTEND
+	size_t size;    // LSB ? FREE : ALLOC; LSB2 ? END : NOTEND; LSB3 ? CLEAN
 	char start[];
 };
 
@@ -43,12 +133,18 @@ struct mcb *mcb_next(struct mcb *mcb);
 
 #define FREE    (1<<0)
 #define END     (1<<1)
+#define CLEAN   (1<<2)	// free and zeroed apart from the free-list links
+
+#define MCB_FLAGS	(END|FREE|CLEAN)
 
-#define mcb_size(m)		((m)->size & (~(END|FREE)))
+#define mcb_size(m)		((m)->size & (~MCB_FLAGS))
 #define mcb_isfree(m)		((m)->size & FREE)
 #define mcb_isend(m)		((m)->size & END)
 #define mcb_setfree(m)		((m)->size |= FREE)
 #define mcb_clrfree(m)		((m)->size &= ~FREE)
 #define mcb_copyend(m, n)	((m)->size |= mcb_isend(n) ? END : 0)
+#define mcb_isclean(m)		((m)->size & CLEAN)
+#define mcb_setclean(m)		((m)->size |= CLEAN)
+#define mcb_clrclean(m)		((m)->size &= ~CLEAN)
 
 #endif
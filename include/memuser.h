@@ -0,0 +1,16 @@
+#ifndef FIJI_MEMUSER_H
+#define FIJI_MEMUSER_H
+
+// Memory menu commands for the command handler
+
+// Shows the statistics of every kernel object cache
+void slab_info(void);
+
+// Reads mem options from the user and runs mem() with them
+void heap_command(void);
+
+// The mem command: lists, allocates and frees MCB heap blocks and reports
+// heap statistics; argv[0] is the command name
+int mem(int argc, char *argv[]);
+
+#endif //FIJI_MEMUSER_H
@@ -0,0 +1,64 @@
+#ifndef MPX_ARENA_H
+#define MPX_ARENA_H
+
+/**
+ @file mpx/arena.h
+ @brief Per-process heap arenas
+
+ While a user process is running, sys_alloc_mem() takes memory from an
+ arena owned by that process instead of the shared heap. Small objects are
+ carved from a chain of chunks by bumping a pointer. A freed small object
+ goes on a free list for its size and is handed out again by the next
+ request of that size. Larger objects come from the shared heap and go
+ straight back to it when freed. Whatever is still allocated is returned
+ at once when the owner is freed. Allocations made by the kernel itself,
+ including from inside a system call, keep going to the shared heap.
+*/
+
+#include <stddef.h>
+
+/** Size of a regular arena chunk, in bytes, including its header */
+#define ARENA_CHUNK_SIZE 4096
+
+/** Largest object carved from chunks; bigger ones use the shared heap */
+#define ARENA_SMALL_MAX 512
+
+struct arena;
+
+/**
+ Installs the arena layer in front of a heap with sys_set_heap_functions().
+ @param alloc_fn The shared heap's allocation function
+ @param free_fn The shared heap's free function
+*/
+void arena_init(void *(*alloc_fn)(size_t), int (*free_fn)(void *));
+
+/**
+ Allocates memory from an arena, creating the arena if needed.
+ @param arena The arena; NULL for an empty arena
+ @param size The number of bytes needed
+ @return NULL if the heap is exhausted, otherwise the memory
+*/
+void *arena_alloc(struct arena **arena, size_t size);
+
+/**
+ Frees memory from an arena so the arena can reuse it.
+ @param arena The arena
+ @param ptr Memory returned by arena_alloc()
+ @return 0 if ptr is an allocated object of the arena, -1 otherwise,
+         including for pointers into an object and objects already freed
+*/
+int arena_free(struct arena **arena, void *ptr);
+
+/**
+ Returns all of an arena's memory to the shared heap and empties it.
+ @param arena The arena
+*/
+void arena_release(struct arena **arena);
+
+/**
+ @param arena The arena
+ @return The number of heap bytes the arena holds
+*/
+size_t arena_size(struct arena *arena);
+
+#endif
@@ -0,0 +1,20 @@
+#ifndef MPX_IDLE_H
+#define MPX_IDLE_H
+
+/**
+ @file mpx/idle.h
+ @brief The system idle process
+
+ The idle process has the lowest priority, so it only runs when nothing
+ else is ready. Each time it runs it clears a bounded batch of free frames
+ into the pool behind vm_map_zeroed_page(), so that new slab pages do not
+ have to be cleared when they are mapped, and then yields.
+*/
+
+/** Frames cleared each time the idle process runs */
+#define IDLE_ZERO_FRAMES 8
+
+/** Body of the system idle process. */
+void idle_process(void);
+
+#endif
@@ -0,0 +1,36 @@
+#ifndef MPX_KSYMS_H
+#define MPX_KSYMS_H
+
+/**
+ @file mpx/ksyms.h
+ @brief The kernel's embedded symbol table
+
+ kernel.bin is linked twice. The first link only serves to list its text
+ symbols with nm; make/ksyms.sh turns that list into kernel/ksyms_table.c,
+ which the second link embeds. The table adds no code, so the addresses
+ it records are the final ones.
+*/
+
+#include <stdint.h>
+
+/** A text symbol */
+struct ksym {
+	uintptr_t addr;		/** Start address */
+	const char *name;	/** Symbol name */
+};
+
+/** Text symbols sorted by address */
+extern const struct ksym ksyms[];
+
+/** Number of entries in ksyms */
+extern const unsigned int nksyms;
+
+/**
+ Finds the symbol containing an address.
+ @param addr A code address
+ @param offset Receives addr minus the start of the symbol
+ @return The symbol name, or NULL if addr precedes every symbol
+*/
+const char *ksym_lookup(uintptr_t addr, uintptr_t *offset);
+
+#endif
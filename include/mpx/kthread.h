@@ -0,0 +1,67 @@
+#ifndef MPX_KTHREAD_H
+#define MPX_KTHREAD_H
+
+/**
+ @file mpx/kthread.h
+ @brief Lightweight kernel worker threads
+
+ Workers run on small private stacks and are entered from the dispatcher
+ with a callee-saved-register switch instead of an interrupt frame. They
+ are cooperative: a worker runs until it calls kthread_yield() or
+ kthread_wait(), and the dispatcher gives every ready worker one turn each
+ time it picks a process. Workers run with interrupts disabled, so each
+ turn should be short and keep its stack frames shallow.
+*/
+
+/** Size of a worker stack, in bytes */
+#define KTHREAD_STACK_SIZE 2048
+
+/** Worker states */
+#define KTHREAD_READY	0
+#define KTHREAD_WAITING	1
+#define KTHREAD_DEAD	2
+
+struct kthread {
+	char name[16];		/** Name, for diagnostics */
+	int state;		/** One of the KTHREAD_* states */
+	void *esp;		/** Saved stack pointer while switched out */
+	void (*fn)(void *);	/** Body; the thread dies when it returns */
+	void *arg;		/** Passed to fn */
+	char *stack;		/** Lowest address of the stack */
+	struct kthread *next;	/** Next worker in the run list */
+};
+
+/**
+ Creates a ready worker thread.
+ @param name Name of the worker (truncated to 15 characters)
+ @param fn Function the worker runs
+ @param arg Argument passed to fn
+ @return The new worker, or NULL if memory could not be allocated
+*/
+struct kthread *kthread_create(const char *name, void (*fn)(void *), void *arg);
+
+/** Called by a worker to give the CPU back to the dispatcher. */
+void kthread_yield(void);
+
+/** Called by a worker to sleep until kthread_wake() is called on it. */
+void kthread_wait(void);
+
+/**
+ Makes a waiting worker ready again.
+ @param thread The worker to wake
+*/
+void kthread_wake(struct kthread *thread);
+
+/**
+ Gives every ready worker one turn. Called by the dispatcher.
+*/
+void kthread_run(void);
+
+/**
+ Switches stacks, saving and restoring callee-saved registers.
+ @param save_esp Receives the stack pointer being switched away from
+ @param load_esp The stack pointer to switch to
+*/
+void kthread_switch(void **save_esp, void *load_esp);
+
+#endif
@@ -0,0 +1,43 @@
+#ifndef MPX_MULTIBOOT_H
+#define MPX_MULTIBOOT_H
+
+/**
+ @file mpx/multiboot.h
+ @brief Structures passed to the kernel by a Multiboot loader
+*/
+
+#include <stdint.h>
+
+/** Value in EAX when a Multiboot loader enters the kernel */
+#define MULTIBOOT_BOOTLOADER_MAGIC 0x2BADB002
+
+/** multiboot_info flags: which fields are valid */
+#define MULTIBOOT_INFO_MEMORY	(1 << 0)	/** mem_lower and mem_upper */
+#define MULTIBOOT_INFO_CMDLINE	(1 << 2)	/** cmdline */
+#define MULTIBOOT_INFO_MMAP	(1 << 6)	/** mmap_length and mmap_addr */
+
+/** Memory map entry type for RAM the kernel may use */
+#define MULTIBOOT_MEMORY_AVAILABLE 1
+
+struct multiboot_info {
+	uint32_t flags;		/** MULTIBOOT_INFO_* bits */
+	uint32_t mem_lower;	/** KB of memory below 1 MB */
+	uint32_t mem_upper;	/** KB of memory above 1 MB, up to the first hole */
+	uint32_t boot_device;
+	uint32_t cmdline;	/** Physical address of the command line */
+	uint32_t mods_count;
+	uint32_t mods_addr;
+	uint32_t syms[4];
+	uint32_t mmap_length;	/** Bytes of memory map */
+	uint32_t mmap_addr;	/** Physical address of the first entry */
+} __attribute__((packed));
+
+/** One memory map entry; size does not count the size field itself */
+struct multiboot_mmap_entry {
+	uint32_t size;
+	uint64_t addr;
+	uint64_t len;
+	uint32_t type;		/** MULTIBOOT_MEMORY_AVAILABLE or reserved */
+} __attribute__((packed));
+
+#endif
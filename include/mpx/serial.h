@@ -50,4 +50,31 @@ int serial_out(device dev, const char *buffer, size_t len);
 
 int serial_poll(device dev, char *buffer, size_t len);
 
+/** A line being read from a serial port, a few characters at a time */
+struct serial_line {
+	char *buffer;	/** Where the line is stored */
+	size_t len;	/** Size of buffer, including the terminator */
+	size_t count;	/** Characters in the line so far */
+	size_t cursor;	/** Editing position within the line */
+	int escape;	/** Progress through an escape sequence */
+};
+
+/**
+ Starts reading a line
+ @param line The line to set up
+ @param buffer A buffer to write data into as it is read
+ @param len The size of buffer
+*/
+void serial_line_init(struct serial_line *line, char *buffer, size_t len);
+
+/**
+ Adds the characters that have already arrived to a line, echoing and
+ editing it the way serial_poll() does, but without waiting for input
+ @param dev The serial port to read from
+ @param line A line set up by serial_line_init()
+ @return 1 once the line is finished (line->count holds its length), 0 if
+         more input is needed
+*/
+int serial_line_poll(device dev, struct serial_line *line);
+
 #endif
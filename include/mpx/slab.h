@@ -0,0 +1,93 @@
+#ifndef MPX_SLAB_H
+#define MPX_SLAB_H
+
+/**
+ @file mpx/slab.h
+ @brief Object caches for fixed-size kernel objects
+
+ A cache hands out objects of one size carved from slabs, which are pages
+ mapped in a virtual range of their own. An object's constructor runs
+ once, when its slab is created. After that, objects move between the
+ cache's free lists and their users without being touched again. A freed
+ object must therefore be returned in its constructed state; the next
+ caller gets it exactly as it was left. Empty slabs stay with the cache
+ until kmem_cache_shrink() unmaps them and frees their frames.
+*/
+
+#include <stddef.h>
+
+/** Size of a slab: one page, which also bounds the object size */
+#define SLAB_SIZE 4096
+
+/** Most slabs that can exist at once, across all caches */
+#define SLAB_SLOTS 1024
+
+/** Longest cache name, including the terminator */
+#define KMEM_NAME_LEN 16
+
+struct slab;
+
+struct kmem_cache {
+	char name[KMEM_NAME_LEN];	/** Name, for statistics */
+	size_t size;			/** Object size, rounded up to align */
+	size_t align;			/** Object alignment (power of two) */
+	void (*ctor)(void *);		/** Run on each object of a new slab */
+	unsigned int per_slab;		/** Objects in each slab */
+	struct slab *slabs;		/** All slabs, ones with free objects first */
+	unsigned int nslabs;		/** Slabs currently held */
+	unsigned int in_use;		/** Objects currently allocated */
+	unsigned long allocs;		/** Successful kmem_cache_alloc() calls */
+	unsigned long frees;		/** Successful kmem_cache_free() calls */
+	unsigned long grows;		/** Slab pages mapped */
+	unsigned long failures;		/** Allocations no page could be mapped for */
+	struct kmem_cache *next;	/** Next cache in the global list */
+};
+
+/**
+ Creates an object cache.
+ @param name Name shown in statistics (truncated to 15 characters)
+ @param size Size of each object in bytes
+ @param align Object alignment; 0 for pointer alignment, at most SLAB_SIZE / 2
+ @param ctor Constructor run once per object when its slab is created,
+             or NULL to hand out zeroed objects
+ @return The new cache, or NULL if memory could not be allocated or an
+         object does not fit in a slab
+*/
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align,
+				     void (*ctor)(void *));
+
+/**
+ Allocates a constructed object, growing the cache by a slab if needed.
+ @param cache The cache to allocate from
+ @return NULL if no memory is available, otherwise the object
+*/
+void *kmem_cache_alloc(struct kmem_cache *cache);
+
+/**
+ Checks an object without freeing it, so callers can validate before they
+ tear the object down.
+ @param cache The cache the object should come from
+ @param obj The object
+ @return Non-zero if obj is an allocated object of cache
+*/
+int kmem_cache_owns(struct kmem_cache *cache, const void *obj);
+
+/**
+ Returns an object to its cache.
+ @param cache The cache the object was allocated from
+ @param obj The object, in its constructed state
+ @return 0 on success, -1 if obj is not an allocated object of cache
+*/
+int kmem_cache_free(struct kmem_cache *cache, void *obj);
+
+/**
+ Releases a cache's empty slabs back to the heap.
+ @param cache The cache to shrink, or NULL for every cache
+ @return The number of slabs released
+*/
+int kmem_cache_shrink(struct kmem_cache *cache);
+
+/** @return The first cache in the global list; follow next for the rest */
+struct kmem_cache *kmem_cache_list(void);
+
+#endif
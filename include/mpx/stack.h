@@ -0,0 +1,77 @@
+#ifndef MPX_STACK_H
+#define MPX_STACK_H
+
+/**
+ @file mpx/stack.h
+ @brief Demand-paged process stacks
+
+ Process stacks live in a reserved virtual range, one slot per stack.
+ Each slot has an unmapped guard page below the stack. Only the top page
+ is committed when the stack is allocated. The rest is committed one page
+ at a time by the page fault handler as the stack grows into it. A fault
+ on a guard page is a stack overflow and panics, naming the owner.
+ Committed pages are filled with STACK_CANARY, so the peak depth of a
+ stack can be found afterwards by looking for the deepest word that no
+ longer holds it.
+*/
+
+#include <stddef.h>
+
+/** Size of a process stack, in bytes (a multiple of the page size) */
+#define STACK_SIZE 0x4000
+
+/** Number of stacks that can exist at once */
+#define STACK_SLOTS 1024
+
+/**
+ Fill word of freshly committed stack pages. It is unlikely to be a real
+ value, unlike zero, which stacks hold all the time.
+*/
+#define STACK_CANARY 0x5AC4CA5Eu
+
+/**
+ stack_check() warns when a process is dispatched with fewer than this
+ many bytes of stack left; 0 turns the check off.
+*/
+#ifndef STACK_WARN_BYTES
+#define STACK_WARN_BYTES 0
+#endif
+
+/**
+ Reserves a stack and commits its top page.
+ @param owner Name reported if the stack overflows; must outlive the stack
+ @return The lowest address of the stack, or NULL if none is available
+*/
+void *stack_alloc(const char *owner);
+
+/**
+ Releases a stack and the frames of every page it committed.
+ @param stack An address returned by stack_alloc()
+*/
+void stack_free(void *stack);
+
+/**
+ Handles a not-present page fault. Commits the page if it belongs to an
+ allocated stack, and panics if it is a guard page.
+ @param addr The faulting address
+ @return 0 if the page was committed, -1 if addr is not in a stack
+*/
+int stack_fault(void *addr);
+
+/**
+ Measures the deepest a stack has grown. Committed pages start out filled
+ with STACK_CANARY, so this finds the lowest word that no longer holds it.
+ @param stack An address returned by stack_alloc()
+ @return The peak number of bytes used, or 0 if stack is not a stack
+*/
+size_t stack_usage(const void *stack);
+
+/**
+ Warns once per stack, on COM1, if sp is within STACK_WARN_BYTES of the
+ bottom of the stack.
+ @param stack An address returned by stack_alloc()
+ @param sp The process's saved stack pointer
+*/
+void stack_check(const void *stack, const void *sp);
+
+#endif
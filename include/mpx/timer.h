@@ -0,0 +1,16 @@
+#ifndef MPX_TIMER_H
+#define MPX_TIMER_H
+
+/**
+ @file mpx/timer.h
+ @brief Kernel functions for the programmable interval timer
+*/
+
+/**
+ Programs the PIT to interrupt TIMER_HZ times per second, installs the
+ timer interrupt handler, and fills the time page from the RTC. Must be
+ called after pic_init() and with interrupts disabled.
+*/
+void timer_init(void);
+
+#endif
@@ -8,20 +8,70 @@
 
 #include <stddef.h>
 
+struct multiboot_info;
+
 /**
  Allocates memory from a primitive heap.
  @param size The size of memory to allocate
  @param align If non-zero, align the allocation to a page boundary
  @param phys_addr If non-NULL, a pointer to a pointer that will
                   hold the physical address of the new memory
- @return The newly allocated memory
+ @return The newly allocated memory, or NULL once the kernel heap has
+         reached its limit or physical memory is exhausted
  */
 void *kmalloc(size_t size, int align, void **phys_addr);
 
+/**
+ Maps a newly allocated frame at a virtual address in the kernel page
+ directory, creating its page table if necessary.
+ @param virt The page-aligned virtual address to map
+ @return 0 on success, -1 if no frame or page table could be allocated
+*/
+int vm_map_page(void *virt);
+
+/**
+ Unmaps a page and releases its frame for reuse.
+ @param virt The page-aligned virtual address to unmap
+*/
+void vm_unmap_page(void *virt);
+
+/**
+ Like vm_map_page(), but the page reads as zeroes. Frames cleared ahead of
+ time by vm_zero_frames() are used first, so the caller usually does not
+ pay for the clearing.
+ @param virt The page-aligned virtual address to map
+ @return 0 on success, -1 if no frame or page table could be allocated
+*/
+int vm_map_zeroed_page(void *virt);
+
+/**
+ Clears free frames into the pool vm_map_zeroed_page() draws from. Meant
+ for the idle process, with interrupts enabled; no interrupt handler maps
+ or frees frames, so the pool cannot change under it.
+ @param max The most frames to clear in this call
+ @return The number of frames cleared; 0 once the pool is full
+*/
+unsigned int vm_zero_frames(unsigned int max);
+
+/**
+ Records the memory information passed by the loader. Must be called
+ before vm_init(); without it, vm_init() assumes 64 MB of memory.
+ @param mbi The multiboot info structure, or NULL if there is none
+*/
+void vm_memory_map(const struct multiboot_info *mbi);
+
+/**
+ @return The bytes of RAM the loader reported as available, as counted
+         by vm_init()
+*/
+size_t vm_usable_memory(void);
+
 /**
  Initializes the kernel page directory and initial kernel heap area.
  Performs identity mapping of the kernel frames such that the virtual
- addresses are equivalent to the physical addresses.
+ addresses are equivalent to the physical addresses. The frame bitmap is
+ sized from the memory map given to vm_memory_map(), and only frames in
+ available regions are ever allocated.
 */
 void vm_init(void);
 
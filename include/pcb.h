@@ -5,6 +5,7 @@
 #define FIJI_PCB_H
 
 #include "memory.h"
+#include <stdint.h>
 
 // Process classes
 #define USER_PROCESS 0
@@ -19,25 +20,38 @@
 #define NOT_SUSPENDED 0
 #define SUSPENDED 1
 
+// Size of a cache line; each PCB starts on one and fills exactly one
+#define PCB_ALIGN 64
+
+// Queue walks and dispatch only read the fields up to class, which sit
+// together at the front. The name is compared through name_hash first,
+// so a scan does not touch the cold fields of PCBs it skips.
 struct pcb {
-    char name[16];            // Unique process name
-    int class;                // Class of the process
+    struct pcb *next;         // Pointer to the next PCB for building queues
+    void *stack_pointer;      // Stack pointer
+    uint32_t name_hash;       // Hash of name, checked before comparing names
     int priority;             // Process priority
     int exec_state;           // Execution state
     int disp_state;           // Dispatching state
-    char stack[6700];         // Pointer to the process stack
-    void *stack_pointer;      // Stack pointer
-    struct pcb *next;         // Pointer to the next PCB for building queues
-//    struct context *context;
-};
+    int sleeping;             // Non-zero while blocked in SLEEP
+    uint32_t wake_tick;       // Timer tick at which a sleeping process wakes
+    int pid;                  // Process identifier
+    int class;                // Class of the process
+    char name[16];            // Unique process name
+    char *stack;              // Lowest address of the demand-paged process stack
+    struct arena *arena;      // Heap memory the process allocated, freed with it
+} __attribute__((aligned(PCB_ALIGN)));
 
 // Function prototypes
 struct pcb* pcb_allocate(void);
 int pcb_free(struct pcb*);
+void pcb_unregister(struct pcb*);
 struct pcb* pcb_setup(const char*, int, int);
 struct pcb* pcb_find(const char*);
+struct pcb* pcb_find_pid(int);
 void pcb_insert(struct pcb*);
 int pcb_remove(struct pcb*);
+void pcb_set_context(struct pcb*, void (*)(void));
 void resume_pcb_kernel(struct pcb*);
 
 
@@ -13,4 +13,5 @@ void show_ready(void);
 void show_blocked(void);
 void show_all(void);
 void display_pcb(struct pcb *target);
+void stack_usage_all(void);
 
@@ -1,7 +1,35 @@
 // Header for the sys_call.c file
 
+#ifndef FIJI_SYS_CALL_H
+#define FIJI_SYS_CALL_H
+
 #include <pcb.h>
+#include <context.h>
+#include <sys_req.h>
+
+// Size of the system call table; op codes must be below this
+#define MAX_SYS_CALLS 32
+
+// A system call handler. Arguments arrive in ctx->ebx, ctx->ecx and ctx->edx.
+// Handlers that only compute a value store it in ctx->eax and return ctx;
+// handlers that give up the CPU return the context of the next process.
+typedef struct context *(*sys_call_fn)(struct context *ctx);
+
+// Handler flags
+#define SYS_CALL_BLOCKS  (1 << 0) // May give up the CPU; ends a submitted batch
+#define SYS_CALL_NOBATCH (1 << 1) // Never allowed in a submitted batch
 
 struct context *sys_call(struct context *);
 
+// Installs the handler for an op code, replacing any previous one
+int sys_call_register(op_code op, sys_call_fn fn, int flags);
+
+// Registers the built-in system calls; must run before the first int 0x60
+void sys_call_init(void);
+
+extern struct pcb *current_pcb;
+
+// Non-zero while sys_call() runs, so kernel work is not charged to the caller
+extern int in_sys_call;
 
+#endif //FIJI_SYS_CALL_H
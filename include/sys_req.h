@@ -1,6 +1,8 @@
 #ifndef MPX_SYS_REQ_H
 #define MPX_SYS_REQ_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include <mpx/device.h>
 
 /**
@@ -13,19 +15,108 @@ typedef enum {
 	IDLE,
 	READ,
 	WRITE,
+	SLEEP,
+	SPAWN,
+	GETPID,
+	SUBMIT,
 } op_code;
-    
+
 // error codes
 #define INVALID_OPERATION	(-1)
 #define INVALID_BUFFER		(-2)
 #define INVALID_COUNT		(-3)
 
+/**
+ Trap into the kernel with an operation and up to three arguments.
+ Arguments are passed in EBX, ECX and EDX; the result comes back in EAX.
+ @param op The operation to perform
+ @param a First argument (EBX)
+ @param b Second argument (ECX)
+ @param c Third argument (EDX)
+ @return Varies by operation
+*/
+static inline int sys_req3(op_code op, uintptr_t a, uintptr_t b, uintptr_t c)
+{
+	int ret;
+	__asm__ volatile ("int $0x60"
+			  : "=a"(ret)
+			  : "a"(op), "b"(a), "c"(b), "d"(c)
+			  : "memory");
+	return ret;
+}
+
+/** Yield the CPU to the next ready process. */
+static inline int sys_idle(void)
+{
+	return sys_req3(IDLE, 0, 0, 0);
+}
+
+/** Terminate the calling process. */
+static inline int sys_exit(void)
+{
+	return sys_req3(EXIT, 0, 0, 0);
+}
+
+/**
+ Read from a device.
+ @param dev The device to read from
+ @param buf The buffer to fill
+ @param len The maximum number of bytes to read
+ @return The number of bytes read, or a negative error code
+*/
+static inline int sys_read(device dev, char *buf, size_t len)
+{
+	return sys_req3(READ, dev, (uintptr_t)buf, len);
+}
+
+/**
+ Write to a device.
+ @param dev The device to write to
+ @param buf The bytes to write
+ @param len The number of bytes to write
+ @return The number of bytes written, or a negative error code
+*/
+static inline int sys_write(device dev, const char *buf, size_t len)
+{
+	return sys_req3(WRITE, dev, (uintptr_t)buf, len);
+}
+
+/**
+ Block the calling process for a number of timer ticks.
+ @param ticks The number of ticks to sleep (TIMER_HZ per second)
+ @return 0 once the process has been woken up
+*/
+static inline int sys_sleep(unsigned int ticks)
+{
+	return sys_req3(SLEEP, ticks, 0, 0);
+}
+
+/**
+ Create a new ready user process.
+ @param name The name of the new process (1-15 characters, not in use)
+ @param entry The function the process starts executing
+ @param priority The priority of the new process (0-9)
+ @return The PID of the new process, or a negative error code
+*/
+static inline int sys_spawn(const char *name, void (*entry)(void), int priority)
+{
+	return sys_req3(SPAWN, (uintptr_t)name, (uintptr_t)entry, priority);
+}
+
+/** @return The PID of the calling process */
+static inline int sys_getpid(void)
+{
+	return sys_req3(GETPID, 0, 0, 0);
+}
+
 /**
  Request an MPX kernel operation.
+ Defined in user/core.c. Only READ and WRITE pass their arguments; use the
+ typed functions above for the other operations.
  @param op_code One of READ, WRITE, IDLE, or EXIT
  @param ... As required for READ or WRITE
  @return Varies by operation
-*/ 
+*/
 int sys_req(op_code op, ...);
- 
+
 #endif
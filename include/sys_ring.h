@@ -0,0 +1,108 @@
+#ifndef MPX_SYS_RING_H
+#define MPX_SYS_RING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys_req.h>
+
+/**
+ @file sys_ring.h
+ @brief Batched system requests through a submission/completion ring
+
+ A process queues several requests in the submission queue, traps into the
+ kernel once with sys_ring_submit(), and collects the results from the
+ completion queue. Requests that may give up the CPU (IDLE, SLEEP) end a
+ batch; anything queued behind them stays queued for the next submit.
+*/
+
+/** Number of entries in each queue; must be a power of two */
+#define SYS_RING_SIZE 16
+
+/** A queued request */
+struct sys_sqe {
+	op_code op;		/** The operation to perform */
+	uintptr_t a;		/** First argument (as EBX) */
+	uintptr_t b;		/** Second argument (as ECX) */
+	uintptr_t c;		/** Third argument (as EDX) */
+	uint32_t user_data;	/** Copied to the completion */
+};
+
+/** The result of a request */
+struct sys_cqe {
+	int result;		/** Value the request would have returned */
+	uint32_t user_data;	/** From the matching submission */
+};
+
+/** A ring owned by one process; indices only ever increase */
+struct sys_ring {
+	uint32_t sq_head;	/** Next submission the kernel consumes */
+	uint32_t sq_tail;	/** Next free submission slot */
+	uint32_t cq_head;	/** Next completion the process reaps */
+	uint32_t cq_tail;	/** Next completion slot the kernel fills */
+	struct sys_sqe sq[SYS_RING_SIZE];
+	struct sys_cqe cq[SYS_RING_SIZE];
+};
+
+/**
+ Reset a ring to empty.
+ @param ring The ring to initialize
+*/
+void sys_ring_init(struct sys_ring *ring);
+
+/**
+ Queue a request without entering the kernel.
+ @param ring The ring to queue on
+ @param op The operation
+ @param a First argument
+ @param b Second argument
+ @param c Third argument
+ @param user_data Tag returned with the completion
+ @return 0 on success, -1 if the ring has no room
+*/
+int sys_ring_queue(struct sys_ring *ring, op_code op, uintptr_t a,
+		   uintptr_t b, uintptr_t c, uint32_t user_data);
+
+/**
+ Queue a WRITE request.
+ @param ring The ring to queue on
+ @param dev The device to write to
+ @param buf The bytes to write; must stay valid until submitted
+ @param len The number of bytes to write
+ @return 0 on success, -1 if the ring has no room
+*/
+int sys_ring_write(struct sys_ring *ring, device dev, const char *buf, size_t len);
+
+/**
+ Queue a READ request.
+ @param ring The ring to queue on
+ @param dev The device to read from
+ @param buf The buffer to fill
+ @param len The maximum number of bytes to read
+ @return 0 on success, -1 if the ring has no room
+*/
+int sys_ring_read(struct sys_ring *ring, device dev, char *buf, size_t len);
+
+/**
+ Queue a SLEEP request. Ends the batch it is submitted in.
+ @param ring The ring to queue on
+ @param ticks The number of ticks to sleep
+ @return 0 on success, -1 if the ring has no room
+*/
+int sys_ring_sleep(struct sys_ring *ring, unsigned int ticks);
+
+/**
+ Hand every queued request to the kernel with a single trap.
+ @param ring The ring to submit
+ @return The number of requests consumed, or a negative error code
+*/
+int sys_ring_submit(struct sys_ring *ring);
+
+/**
+ Take the oldest completion off the ring.
+ @param ring The ring to reap from
+ @param cqe Filled with the completion
+ @return 1 if a completion was returned, 0 if there were none
+*/
+int sys_ring_reap(struct sys_ring *ring, struct sys_cqe *cqe);
+
+#endif
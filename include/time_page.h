@@ -0,0 +1,74 @@
+#ifndef MPX_TIME_PAGE_H
+#define MPX_TIME_PAGE_H
+
+#include <stdint.h>
+
+/**
+ @file time_page.h
+ @brief Kernel time page, readable by every process without a system call
+
+ The timer interrupt updates the page TIMER_HZ times per second. Writers
+ make the sequence counter odd while they update and even again when they
+ are done, so a reader retries if the counter was odd or changed while it
+ was copying.
+*/
+
+/** Timer interrupts per second */
+#define TIMER_HZ 100
+
+struct time_page {
+	volatile uint32_t seq;	/** Odd while an update is in progress */
+	uint32_t tsc_per_tick;	/** TSC cycles measured over the last tick */
+	uint64_t ticks;		/** Timer ticks since boot */
+	uint64_t tsc_at_tick;	/** TSC value when the last tick was taken */
+	uint8_t seconds;	/** Wall-clock time, decoded from the RTC */
+	uint8_t minutes;
+	uint8_t hours;
+	uint8_t day;
+	uint8_t month;
+	uint8_t year;		/** Two-digit year */
+};
+
+/** The page itself; only the timer interrupt writes to it */
+extern struct time_page kernel_time_page;
+
+/**
+ Read the time stamp counter.
+ @return The current TSC value
+*/
+static inline uint64_t rdtsc(void)
+{
+	uint64_t tsc;
+	__asm__ volatile ("rdtsc" : "=A"(tsc));
+	return tsc;
+}
+
+/**
+ Take a consistent copy of the time page.
+ @param snap Filled with the current contents of the page
+*/
+static inline void time_page_read(struct time_page *snap)
+{
+	uint32_t seq;
+	do {
+		while ((seq = kernel_time_page.seq) & 1) {
+			// an update is in progress
+		}
+		__asm__ volatile ("" ::: "memory");
+		*snap = kernel_time_page;
+		__asm__ volatile ("" ::: "memory");
+	} while (seq != kernel_time_page.seq);
+}
+
+/**
+ Read the tick count.
+ @return Timer ticks since boot
+*/
+static inline uint64_t time_page_ticks(void)
+{
+	struct time_page snap;
+	time_page_read(&snap);
+	return snap.ticks;
+}
+
+#endif
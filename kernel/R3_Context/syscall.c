@@ -1,55 +1,314 @@
 #include "context.h"
 #include "pcb.h"
+#include "sys_call.h"
+#include "sys_ring.h"
+#include "time_page.h"
+#include <mpx/kthread.h>
+#include <mpx/stack.h>
 #include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+#include <mpx/serial.h>
 
-#define IDLE 1      // Define IDLE as 1, used in sys_call to represent idle system call
-#define EXIT 0      // Define EXIT as 0, used in sys_call for exit system call
+// Most READs that can wait for input at once
+#define MAX_READERS 4
+
+// Bytes of the int $0x60 instruction, stepped back over to retry a call
+#define INT_INSN_SIZE 2
+
+// An entry in the system call table
+struct sys_call_entry {
+    sys_call_fn fn; // Handler, or NULL if the op code is unused
+    int flags;      // SYS_CALL_* flags
+};
+
+// A READ whose caller is blocked until its line is complete
+struct pending_read {
+    int pid;                 // PID of the blocked reader, 0 if the slot is free
+    device dev;              // Device it reads from
+    struct serial_line line; // The line read so far
+};
 
 // Global variables
 struct pcb *current_pcb = NULL;             // Pointer to the current running PCB
+int in_sys_call = 0;                        // Non-zero while the kernel handles a system call
 static struct context *initial_context = NULL; // Initial context stored during the first IDLE call
+static struct sys_call_entry sys_call_table[MAX_SYS_CALLS] = { { NULL, 0 } }; // Handlers indexed by op code
+static struct pcb *zombies = NULL;          // Exited PCBs waiting to be freed by the reaper
+static struct pcb *dying = NULL;            // Exited PCB whose stack the kernel is still running on
+static struct kthread *reaper = NULL;       // Worker that frees zombies
+static struct pending_read readers[MAX_READERS]; // Blocked READs, serviced at every dispatch
 
 // Function prototypes
 static void save_context(struct context *ctx); // Saves the context of the current PCB
 static struct pcb* select_next_process(void);  // Selects the next process to run from the ready queue
 static int sys_req_idle(void);                // Checks if the system is idle
-static void terminate_and_free_all_pcbs(struct pcb **queue); // Terminates and frees all PCBs in a queue
+static void terminate_all_pcbs(struct pcb **queue); // Hands every PCB in a queue to the reaper
+static void bury(struct pcb *pcb);            // Adds a PCB to the zombie list
+static void wake_sleepers(void);              // Readies sleeping PCBs whose wake tick has passed
+static void wake_readers(void);               // Readies blocked readers whose line is complete
+static struct context *dispatch(struct context *ctx); // Picks the context to resume
 
 // System call implementation
 struct context *sys_call(struct context *ctx) {
-    switch (ctx->eax) { // Switch based on the system call number stored in eax
-        case IDLE: // IDLE system call
-            if (initial_context == NULL) {
-                initial_context = ctx; // Store the initial context if not already stored
-            }
-            if (current_pcb != NULL) { // If there is a current PCB
-                save_context(ctx); // Save its context
-                current_pcb->exec_state = READY; // Set its state to READY
-                pcb_insert(current_pcb); // Insert it back into the ready queue
-            }
-            break;
+    uint32_t op = (uint32_t)ctx->eax; // System call number stored in eax
+    struct context *next;
+
+    in_sys_call = 1; // Kernel allocations from here on go to the shared heap
+    // We are on another process's stack now, so the last exited PCB can be freed
+    if (dying != NULL) {
+        bury(dying);
+        dying = NULL;
+    }
+
+    if (op >= MAX_SYS_CALLS || sys_call_table[op].fn == NULL) {
+        ctx->eax = INVALID_OPERATION; // Unknown system call
+        next = ctx;
+    } else {
+        next = sys_call_table[op].fn(ctx);
+    }
+    in_sys_call = 0;
+    return next;
+}
+
+// Installs a handler in the system call table
+int sys_call_register(op_code op, sys_call_fn fn, int flags) {
+    if ((uint32_t)op >= MAX_SYS_CALLS) {
+        return -1; // Op code does not fit in the table
+    }
+    sys_call_table[op].fn = fn;
+    sys_call_table[op].flags = flags;
+    return 0;
+}
+
+// IDLE: put the caller back in the ready queue and dispatch
+static struct context *sys_call_idle(struct context *ctx) {
+    if (initial_context == NULL) {
+        initial_context = ctx; // Store the initial context if not already stored
+    }
+    if (current_pcb != NULL) { // If there is a current PCB
+        save_context(ctx); // Save its context
+        current_pcb->exec_state = READY; // Set its state to READY
+        pcb_insert(current_pcb); // Insert it back into the ready queue
+    }
+    return dispatch(ctx);
+}
+
+// EXIT: terminate all PCBs in both ready and blocked queues
+static struct context *sys_call_exit(struct context *ctx) {
+    terminate_all_pcbs(&ReadyQueue);
+    terminate_all_pcbs(&BlockedQueue);
+    memset(readers, 0, sizeof(readers)); // Their readers are gone
 
-        case EXIT: // EXIT system call
-            // Terminate and free all PCBs in both ready and blocked queues
-            terminate_and_free_all_pcbs(&ReadyQueue);
-            terminate_and_free_all_pcbs(&BlockedQueue);
+    if (current_pcb) { // If there is a current PCB
+        pcb_unregister(current_pcb); // Already gone as far as lookups are concerned
+        dying = current_pcb; // Its stack holds ctx, so free it on the next system call
+        current_pcb = NULL; // Set the current PCB pointer to NULL
+    }
+    return dispatch(ctx);
+}
 
-            if (current_pcb) { // If there is a current PCB
-                pcb_free(current_pcb); // Free it
-                current_pcb = NULL; // Set the current PCB pointer to NULL
-            }
+// READ: ebx = device, ecx = buffer, edx = count; blocks the caller until a line is read
+static struct context *sys_call_read(struct context *ctx) {
+    device dev = (device)ctx->ebx;
+    char *buf = (char *)ctx->ecx;
+    size_t len = (size_t)ctx->edx;
+
+    if (buf == NULL) {
+        ctx->eax = INVALID_BUFFER;
+        return ctx;
+    }
+    if (len == 0) {
+        ctx->eax = INVALID_COUNT;
+        return ctx;
+    }
+    if (current_pcb == NULL) {
+        ctx->eax = serial_poll(dev, buf, len); // No process to block, so wait here
+        return ctx;
+    }
+
+    struct pending_read *slot = NULL;
+    for (int i = 0; i < MAX_READERS; i++) {
+        if (readers[i].pid != 0 && readers[i].dev == dev) {
+            slot = NULL; // Someone is already reading this device
             break;
+        }
+        if (readers[i].pid == 0 && slot == NULL) {
+            slot = &readers[i];
+        }
+    }
+    if (slot == NULL) {
+        ctx->eip -= INT_INSN_SIZE; // Issue the same READ again once the caller next runs
+        return sys_call_idle(ctx);
+    }
+
+    serial_line_init(&slot->line, buf, len);
+    if (serial_line_poll(dev, &slot->line)) {
+        ctx->eax = (int)slot->line.count; // The whole line was already waiting
+        return ctx;
+    }
+    slot->pid = current_pcb->pid;
+    slot->dev = dev;
+    save_context(ctx);
+    current_pcb->exec_state = BLOCKED;
+    pcb_insert(current_pcb); // Park it in the blocked queue until wake_readers()
+    current_pcb = NULL;
+    return dispatch(ctx);
+}
+
+// WRITE: ebx = device, ecx = buffer, edx = count
+static struct context *sys_call_write(struct context *ctx) {
+    const char *buf = (const char *)ctx->ecx;
+
+    if (buf == NULL) {
+        ctx->eax = INVALID_BUFFER;
+    } else {
+        ctx->eax = serial_out((device)ctx->ebx, buf, (size_t)ctx->edx);
+    }
+    return ctx;
+}
+
+// SLEEP: ebx = ticks; blocks the caller until that many timer ticks have passed
+static struct context *sys_call_sleep(struct context *ctx) {
+    if (current_pcb == NULL) {
+        ctx->eax = INVALID_OPERATION; // Nothing to put to sleep
+        return ctx;
+    }
+    uint32_t ticks = (uint32_t)ctx->ebx;
+    if (ticks == 0) {
+        return sys_call_idle(ctx); // Sleeping for no time is a yield
+    }
+    if (ticks > INT32_MAX) {
+        ticks = INT32_MAX; // The furthest wake_sleepers() can tell from the past
+    }
+    ctx->eax = 0; // Result seen by the caller once it wakes up
+    save_context(ctx);
+    current_pcb->sleeping = 1;
+    current_pcb->wake_tick = (uint32_t)time_page_ticks() + ticks;
+    current_pcb->exec_state = BLOCKED;
+    pcb_insert(current_pcb); // Park it in the blocked queue
+    current_pcb = NULL;
+    return dispatch(ctx);
+}
+
+// SPAWN: ebx = name, ecx = entry point, edx = priority
+static struct context *sys_call_spawn(struct context *ctx) {
+    const char *name = (const char *)ctx->ebx;
+    void (*entry)(void) = (void (*)(void))ctx->ecx;
+
+    if (name == NULL || entry == NULL) {
+        ctx->eax = INVALID_BUFFER;
+        return ctx;
+    }
+    struct pcb *spawned = pcb_setup(name, USER_PROCESS, ctx->edx);
+    if (spawned == NULL) {
+        ctx->eax = INVALID_OPERATION;
+        return ctx;
+    }
+    pcb_set_context(spawned, entry);
+    pcb_insert(spawned);
+    ctx->eax = spawned->pid;
+    return ctx;
+}
+
+// GETPID: returns the PID of the caller, or 0 from the kernel itself
+static struct context *sys_call_getpid(struct context *ctx) {
+    ctx->eax = current_pcb ? current_pcb->pid : 0;
+    return ctx;
+}
+
+// SUBMIT: ebx = ring; runs queued requests and posts their completions
+static struct context *sys_call_submit(struct context *ctx) {
+    struct sys_ring *ring = (struct sys_ring *)ctx->ebx;
+    int submitted = 0;
 
-        default: // Default case for unknown system call
-            ctx->eax = -1; // Set eax to -1 indicating error
-            return ctx; // Return the context
+    if (ring == NULL) {
+        ctx->eax = INVALID_BUFFER;
+        return ctx;
     }
 
+    while (ring->sq_head != ring->sq_tail && ring->cq_tail - ring->cq_head < SYS_RING_SIZE) {
+        struct sys_sqe *sqe = &ring->sq[ring->sq_head % SYS_RING_SIZE];
+        struct sys_cqe *cqe = &ring->cq[ring->cq_tail % SYS_RING_SIZE];
+        uint32_t op = (uint32_t)sqe->op;
+        struct sys_call_entry *entry = op < MAX_SYS_CALLS ? &sys_call_table[op] : NULL;
+
+        cqe->user_data = sqe->user_data;
+
+        if (entry == NULL || entry->fn == NULL || (entry->flags & SYS_CALL_NOBATCH)) {
+            cqe->result = INVALID_OPERATION;
+        } else if (entry->flags & SYS_CALL_BLOCKS) {
+            // Run it last, on the caller's real context
+            cqe->result = 0;
+            ring->sq_head++;
+            ring->cq_tail++;
+            submitted++;
+            ctx->eax = op;
+            ctx->ebx = sqe->a;
+            ctx->ecx = sqe->b;
+            ctx->edx = sqe->c;
+            struct context *next = entry->fn(ctx);
+            ctx->eax = submitted; // Seen by the caller when it resumes
+            return next;
+        } else {
+            // Value-only calls run on a scratch context
+            struct context scratch = { 0 };
+            scratch.eax = op;
+            scratch.ebx = sqe->a;
+            scratch.ecx = sqe->b;
+            scratch.edx = sqe->c;
+            entry->fn(&scratch);
+            cqe->result = scratch.eax;
+        }
+        ring->sq_head++;
+        ring->cq_tail++;
+        submitted++;
+    }
+
+    ctx->eax = submitted;
+    return ctx;
+}
+
+// Reaper worker: frees exited PCBs off the system call path
+static void reap_zombies(void *arg) {
+    (void)arg;
+    for (;;) {
+        while (zombies != NULL) {
+            struct pcb *zombie = zombies;
+            zombies = zombie->next;
+            pcb_free(zombie);
+        }
+        kthread_wait(); // Until bury() has more work
+    }
+}
+
+// Registers the built-in system calls and starts the reaper
+void sys_call_init(void) {
+    sys_call_register(EXIT, sys_call_exit, SYS_CALL_BLOCKS | SYS_CALL_NOBATCH);
+    sys_call_register(IDLE, sys_call_idle, SYS_CALL_BLOCKS);
+    sys_call_register(READ, sys_call_read, SYS_CALL_BLOCKS | SYS_CALL_NOBATCH);
+    sys_call_register(WRITE, sys_call_write, 0);
+    sys_call_register(SLEEP, sys_call_sleep, SYS_CALL_BLOCKS);
+    sys_call_register(SPAWN, sys_call_spawn, 0);
+    sys_call_register(GETPID, sys_call_getpid, 0);
+    sys_call_register(SUBMIT, sys_call_submit, SYS_CALL_NOBATCH);
+    reaper = kthread_create("reaper", reap_zombies, NULL);
+}
+
+// Picks the next process to run, or returns to the initial context when idle
+static struct context *dispatch(struct context *ctx) {
+    kthread_run(); // Kernel workers get a turn at every dispatch
+    wake_sleepers();
+    wake_readers();
+
     // If there are ready, non-suspended PCBs
     if (sys_req_idle() == 0) {
         struct pcb *next_pcb = select_next_process(); // Select the next PCB
         current_pcb = next_pcb; // Update the current PCB
         current_pcb->exec_state = READY; // Set its state to READY
+        if (STACK_WARN_BYTES > 0) {
+            stack_check(current_pcb->stack, current_pcb->stack_pointer);
+        }
         return (struct context *) current_pcb->stack_pointer; // Return its context
     } else { // If the system is idle
         ctx = initial_context; // Use the initial context
@@ -58,6 +317,43 @@ struct context *sys_call(struct context *ctx) {
     }
 }
 
+// Moves sleeping PCBs that are due to the ready queue
+static void wake_sleepers(void) {
+    uint32_t now = (uint32_t)time_page_ticks();
+    struct pcb *current = BlockedQueue;
+    while (current != NULL) {
+        struct pcb *next = current->next; // pcb_insert() rewrites next
+        if (current->sleeping && (int32_t)(now - current->wake_tick) >= 0) {
+            current->sleeping = 0;
+            pcb_remove(current);
+            current->exec_state = READY;
+            pcb_insert(current);
+        }
+        current = next;
+    }
+}
+
+// Feeds waiting input to blocked READs and readies those whose line is complete
+static void wake_readers(void) {
+    for (int i = 0; i < MAX_READERS; i++) {
+        if (readers[i].pid == 0) {
+            continue;
+        }
+        struct pcb *reader = pcb_find_pid(readers[i].pid);
+        if (reader == NULL) {
+            readers[i].pid = 0; // Deleted while it waited
+            continue;
+        }
+        if (serial_line_poll(readers[i].dev, &readers[i].line)) {
+            ((struct context *)reader->stack_pointer)->eax = (int)readers[i].line.count;
+            readers[i].pid = 0;
+            pcb_remove(reader);
+            reader->exec_state = READY;
+            pcb_insert(reader);
+        }
+    }
+}
+
 // Saves the context by updating the stack pointer of the current PCB
 static void save_context(struct context *ctx) {
     if (current_pcb) {
@@ -87,11 +383,23 @@ static struct pcb* select_next_process(void) {
     return NULL; // Return NULL if no suitable PCB is found
 }
 
-// Terminates and frees all PCBs in a given queue
-static void terminate_and_free_all_pcbs(struct pcb **queue) {
+// Terminates all PCBs in a given queue
+static void terminate_all_pcbs(struct pcb **queue) {
     struct pcb *current;
     while ((current = *queue) != NULL) {
         *queue = current->next; // Move to the next PCB in the queue
-        pcb_free(current); // Free the current PCB
+        bury(current); // Let the reaper free it
+    }
+}
+
+// Queues an exited PCB for the reaper, or frees it now if there is no reaper
+static void bury(struct pcb *pcb) {
+    pcb_unregister(pcb); // It is in no queue, so pcb_find() must not return it
+    if (reaper == NULL) {
+        pcb_free(pcb);
+        return;
     }
+    pcb->next = zombies;
+    zombies = pcb;
+    kthread_wake(reaper);
 }
@@ -0,0 +1,220 @@
+#include <mpx/arena.h>
+#include <memory.h>
+#include <pcb.h>
+#include <sys_call.h>
+#include <stddef.h>
+#include <string.h>
+#include <stdint.h>
+
+#define ARENA_ALIGN 8
+#define ARENA_CLASSES (ARENA_SMALL_MAX / ARENA_ALIGN) // Free lists, one per size
+#define LARGE 1 // Set in arena_obj.size for objects from the shared heap
+#define LIVE 0xA110CA7E // arena_obj.state while the object is allocated
+#define DEAD 0xF4EEF4EE // arena_obj.state while it is on a free list
+
+// A chunk of an arena: this header, then objects carved from the front
+struct arena_chunk {
+    struct arena_chunk *next; // Older chunk
+    size_t size;              // Bytes of data, excluding this header
+    size_t used;              // Bytes carved so far
+    char data[];
+};
+
+// Header in front of every object, ARENA_ALIGN bytes so objects stay aligned
+struct arena_obj {
+    size_t size;              // Bytes of the object, LARGE if from the shared heap
+    size_t state;             // LIVE or DEAD, so bad frees can be refused
+};
+
+// An object too large for the chunks, linked so the arena can free it
+struct arena_large {
+    struct arena_large *next;
+    struct arena_large *prev;
+    struct arena_obj obj;
+};
+
+struct arena {
+    struct arena_chunk *chunks;   // Chunks, newest first
+    struct arena_large *large;    // Live large objects
+    void *free[ARENA_CLASSES];    // Freed small objects by size, linked through their data
+};
+
+static void *(*heap_alloc)(size_t) = NULL; // Shared heap behind the arenas
+static int (*heap_free)(void *) = NULL;
+
+// Arena of the running user process, or NULL when the shared heap should be used
+static struct arena **owner_arena(void) {
+    if (in_sys_call || current_pcb == NULL || current_pcb->class != USER_PROCESS) {
+        return NULL;
+    }
+    return &current_pcb->arena;
+}
+
+// Owner recorded by the heap profiler
+static int current_pid(void) {
+    return current_pcb ? current_pcb->pid : 0;
+}
+
+// sys_alloc_mem() has already told the heap profiler who is asking
+static void *arena_heap_alloc(size_t size) {
+    struct arena **arena = owner_arena();
+    return arena ? arena_alloc(arena, size) : heap_alloc(size);
+}
+
+static int arena_heap_free(void *ptr) {
+    struct arena **arena = owner_arena();
+    if (arena && arena_free(arena, ptr) == 0) {
+        return 0;
+    }
+    return heap_free(ptr); // Memory the kernel handed to the process
+}
+
+void arena_init(void *(*alloc_fn)(size_t), int (*free_fn)(void *)) {
+    heap_alloc = alloc_fn;
+    heap_free = free_fn;
+    sys_set_heap_functions(arena_heap_alloc, arena_heap_free);
+    heap_profile_owner(current_pid);
+}
+
+// Carves size bytes from the newest chunk, adding a chunk if it is full
+static void *carve(struct arena *a, size_t size) {
+    struct arena_chunk *chunk = a->chunks;
+    if (chunk == NULL || chunk->size - chunk->used < size) {
+        struct arena_chunk *fresh = heap_alloc(ARENA_CHUNK_SIZE);
+        if (fresh == NULL) {
+            return NULL;
+        }
+        fresh->size = ARENA_CHUNK_SIZE - sizeof(struct arena_chunk);
+        fresh->used = 0;
+        fresh->next = chunk; // What is left of the old chunk stays unused
+        a->chunks = fresh;
+        chunk = fresh;
+    }
+    void *p = chunk->data + chunk->used;
+    chunk->used += size;
+    return p;
+}
+
+void *arena_alloc(struct arena **arena, size_t size) {
+    if (size > (size_t)-1 - ARENA_CHUNK_SIZE) {
+        return NULL;
+    }
+    size = size ? (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1) : ARENA_ALIGN;
+
+    struct arena *a = *arena;
+    if (a == NULL) {
+        a = heap_alloc(sizeof(struct arena));
+        if (a == NULL) {
+            return NULL;
+        }
+        memset(a, 0, sizeof(*a));
+        *arena = a;
+    }
+
+    if (size > ARENA_SMALL_MAX) {
+        struct arena_large *big = heap_alloc(sizeof(struct arena_large) + size);
+        if (big == NULL) {
+            return NULL;
+        }
+        big->obj.size = size | LARGE;
+        big->obj.state = LIVE;
+        big->prev = NULL;
+        big->next = a->large;
+        if (a->large != NULL) {
+            a->large->prev = big;
+        }
+        a->large = big;
+        return &big->obj + 1;
+    }
+
+    void **list = &a->free[size / ARENA_ALIGN - 1];
+    if (*list != NULL) {
+        void *p = *list; // Reuse a freed object of this size
+        *list = *(void **)p;
+        ((struct arena_obj *)p - 1)->state = LIVE;
+        return p;
+    }
+    struct arena_obj *obj = carve(a, sizeof(struct arena_obj) + size);
+    if (obj == NULL) {
+        return NULL;
+    }
+    obj->size = size;
+    obj->state = LIVE;
+    return obj + 1;
+}
+
+int arena_free(struct arena **arena, void *ptr) {
+    struct arena *a = *arena;
+    char *p = ptr;
+
+    if (a == NULL || ptr == NULL) {
+        return -1;
+    }
+    for (struct arena_chunk *chunk = a->chunks; chunk != NULL; chunk = chunk->next) {
+        if (p > chunk->data && p < chunk->data + chunk->used) {
+            struct arena_obj *obj = (struct arena_obj *)ptr - 1;
+            size_t off = p - chunk->data;
+            // Only the start of an allocated object, whose size fits the chunk
+            if (off % ARENA_ALIGN != 0 || off < sizeof(struct arena_obj) || obj->state != LIVE
+                || obj->size == 0 || obj->size > ARENA_SMALL_MAX || obj->size % ARENA_ALIGN != 0
+                || obj->size > chunk->used - off) {
+                return -1;
+            }
+            obj->state = DEAD;
+            void **list = &a->free[obj->size / ARENA_ALIGN - 1];
+            *(void **)ptr = *list; // Next request of this size gets it back
+            *list = ptr;
+            return 0;
+        }
+    }
+    for (struct arena_large *big = a->large; big != NULL; big = big->next) {
+        if (ptr == &big->obj + 1) {
+            if (big->prev != NULL) {
+                big->prev->next = big->next;
+            } else {
+                a->large = big->next;
+            }
+            if (big->next != NULL) {
+                big->next->prev = big->prev;
+            }
+            heap_free(big);
+            return 0;
+        }
+    }
+    return -1;
+}
+
+void arena_release(struct arena **arena) {
+    struct arena *a = *arena;
+    if (a == NULL) {
+        return;
+    }
+    struct arena_chunk *chunk = a->chunks;
+    while (chunk != NULL) {
+        struct arena_chunk *next = chunk->next;
+        heap_free(chunk);
+        chunk = next;
+    }
+    struct arena_large *big = a->large;
+    while (big != NULL) {
+        struct arena_large *next = big->next;
+        heap_free(big);
+        big = next;
+    }
+    heap_free(a);
+    *arena = NULL;
+}
+
+size_t arena_size(struct arena *arena) {
+    if (arena == NULL) {
+        return 0;
+    }
+    size_t bytes = sizeof(struct arena);
+    for (struct arena_chunk *chunk = arena->chunks; chunk != NULL; chunk = chunk->next) {
+        bytes += sizeof(struct arena_chunk) + chunk->size;
+    }
+    for (struct arena_large *big = arena->large; big != NULL; big = big->next) {
+        bytes += sizeof(struct arena_large) + (big->obj.size & ~(size_t)LARGE);
+    }
+    return bytes;
+}
@@ -1,7 +1,7 @@
 ;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;;
 ; Core bits of the kernel that must be written in assembly. Holds a Multiboot
 ; header (so QEMU will load it directly), creates a basic stack, jumps to
-; kmain(), then attempts to power off QEMU when kmain() returns. If powering
+; kmain() with the multiboot magic and info pointer, then attempts to power off QEMU when kmain() returns. If powering
 ; off QEMU fails, it simply halts the CPU.
 ;
 ; You should not need to make any modifications to this file. Doing so
@@ -32,6 +32,8 @@ multiboot_header:
 ;; kernel entry point
 start:
 	mov esp, stack + STACKSIZE	;; establish a stack
+	push ebx			;; multiboot info structure
+	push eax			;; multiboot magic number
 	call kmain			;; jump to C code
 
 	cli				;; disable interrupts
@@ -26,6 +26,42 @@ struct gdt_descriptor {
         struct gdt_entry * base;
 } __attribute__((packed));
 
+/** A 32-bit task state segment */
+struct tss {
+	uint32_t link;
+	uint32_t esp0, ss0, esp1, ss1, esp2, ss2;
+	uint32_t cr3, eip, eflags;
+	uint32_t eax, ecx, edx, ebx, esp, ebp, esi, edi;
+	uint32_t es, cs, ss, ds, fs, gs, ldt;
+	uint16_t trap, iomap;
+} __attribute__((packed));
+
+// selectors of the two task state segments
+#define KERNEL_TSS_SEL	0x28
+#define FAULT_TSS_SEL	0x30
+
+// stack of the page fault task
+#define FAULT_STACK_SIZE 0x2000
+
+// the task everything normally runs as, and the task page faults switch
+// to; both get the kernel page directory in vm_init()
+static struct tss kernel_tss;
+static struct tss fault_tss;
+static uint8_t fault_stack[FAULT_STACK_SIZE] __attribute__((aligned(16)));
+
+extern void page_fault_task(void);
+
+static void gdt_set_tss(struct gdt_entry *entry, struct tss *tss)
+{
+	uintptr_t base = (uintptr_t)tss;
+	entry->limit_low = sizeof(*tss) - 1;
+	entry->base_low = base & 0xFFFF;
+	entry->base_mid = (base >> 16) & 0xFF;
+	entry->access = 0x89;	// present, available 32-bit TSS
+	entry->flags = 0x00;
+	entry->base_high = (base >> 24) & 0xFF;
+}
+
 void gdt_init(void)
 {
 	/* declared static so that they have permanenent lifetime while not being global */
@@ -35,6 +71,8 @@ void gdt_init(void)
 		{ 0xffff, 0x0, 0x0, 0x92, 0xff, 0x0 },	// DS
 		{ 0xffff, 0x0, 0x0, 0xfa, 0xff, 0x0 },	// User CS
 		{ 0xffff, 0x0, 0x0, 0xf2, 0xff, 0x0 },	// User DS
+		{ 0x0000, 0x0, 0x0, 0x00, 0x00, 0x0 },	// Kernel TSS
+		{ 0x0000, 0x0, 0x0, 0x00, 0x00, 0x0 },	// Page fault TSS
 	};
 
 	static struct gdt_descriptor gdt = {
@@ -42,12 +80,24 @@ void gdt_init(void)
 		.base = table,
 	};
 
+	kernel_tss.iomap = sizeof(kernel_tss);
+	fault_tss.iomap = sizeof(fault_tss);
+	fault_tss.eip = (uintptr_t)page_fault_task;
+	fault_tss.esp = (uintptr_t)(fault_stack + FAULT_STACK_SIZE);
+	fault_tss.eflags = 0x0002;	// interrupts off while handling a fault
+	fault_tss.cs = 0x08;
+	fault_tss.ss = fault_tss.ds = fault_tss.es = 0x10;
+	fault_tss.fs = fault_tss.gs = 0x10;
+	gdt_set_tss(&table[KERNEL_TSS_SEL / 8], &kernel_tss);
+	gdt_set_tss(&table[FAULT_TSS_SEL / 8], &fault_tss);
+
 	__asm__ volatile ("lgdt %0" :: "m"(gdt));
 	__asm__ volatile ("mov %%ax, %%ds" :: "a"(0x10));
 	__asm__ volatile ("mov %%ax, %%es" :: "a"(0x10));
 	__asm__ volatile ("mov %%ax, %%fs" :: "a"(0x10));
 	__asm__ volatile ("mov %%ax, %%gs" :: "a"(0x10));
 	__asm__ volatile ("mov %%ax, %%ss" :: "a"(0x10));
+	__asm__ volatile ("ltr %%ax" :: "a"(KERNEL_TSS_SEL));
 }
 
 /* ************************************************************************
@@ -119,7 +169,6 @@ simple_isr(invalid_tss, "Invalid TSS")
 simple_isr(segment_not_present, "Segment not present")
 simple_isr(stack_segment, "Stack segment error")
 simple_isr(general_protection, "General protection fault")
-simple_isr(page_fault, "Page Fault")
 simple_isr(reserved, "Reserved")
 simple_isr(coprocessor, "Coprocessor error")
 
@@ -175,7 +224,7 @@ void irq_init(void)
 		segment_not_present,
 		stack_segment,
 		general_protection,
-		page_fault,
+		reserved,	// page faults use a task gate, installed below
 		reserved,
 		coprocessor,
 	};
@@ -192,6 +241,10 @@ void irq_init(void)
 		idt_set_gate(i, reserved, sel, flags);
 	}
 
+	// Page faults switch to their own task and stack, so a fault caused
+	// by pushing onto an unmapped stack page can still be handled
+	idt_set_gate(14, NULL, FAULT_TSS_SEL, 0x85);
+
 	// Ignore interrupts from the real time clock
 	idt_set_gate(0x08, rtc_isr, sel, flags);
 
@@ -242,6 +295,8 @@ noreturn void kpanic(const char *msg)
  * ************************************************************************/
 #include <mpx/panic.h>
 #include <mpx/vm.h>
+#include <mpx/multiboot.h>
+#include <mpx/stack.h>
 #include <limits.h>
 #include <string.h>
 #include <stdint.h>
@@ -250,18 +305,31 @@ noreturn void kpanic(const char *msg)
 // TODO: this is very magic
 #define KHEAP_BASE	0xD000000
 
-// The size of the primitive kernel heap
-#define KHEAP_SIZE	0x10000
+// The size the kernel heap may grow to; it is mapped in 4 MB slots as
+// allocations reach them
+#ifndef KHEAP_MAX
+#define KHEAP_MAX	0x1000000
+#endif
+
+// Page tables set aside for heap slots that cannot get a 4 MB page
+#ifndef KHEAP_TABLE_RESERVE
+#define KHEAP_TABLE_RESERVE 1
+#endif
 
 // 4 KB pages
 #define PAGE_SIZE	0x1000
 
-// 64 MB total memory
-// TODO: learn this from boot parameters
-#define MEM_SIZE	0x4000000
+// 4 MB pages, mapped directly by a page directory entry (CR4.PSE)
+#define LARGE_PAGE_SIZE	0x400000
 
-// number of frames
-#define NFRAMES		(MEM_SIZE / PAGE_SIZE)
+// Page directory entry bits
+#define PDE_PRESENT	0x001
+#define PDE_WRITE	0x002
+#define PDE_USER	0x004
+#define PDE_LARGE	0x080
+
+// Memory assumed when the loader gives no memory information
+#define MEM_SIZE	0x4000000
 
 // bits per frame
 #define FRAME_BIT	(sizeof(uint32_t) * CHAR_BIT)
@@ -297,12 +365,26 @@ typedef struct {
 	uint32_t tables_phys[1024];
 } page_dir;
 
-// bitmap of frames
-static uint32_t frames[NFRAMES / FRAME_BIT] = { 0 };
+// bitmap of frames, sized from the memory map by vm_init()
+static uint32_t *frames;
+
+// number of frames, and of bitmap words
+static uint32_t nframes;
+static uint32_t nwords;
+
+// frames vm_init() found free, for vm_usable_memory()
+static uint32_t usable_frames;
+
+// memory information from the loader, if any
+static const struct multiboot_info *boot_info;
 
 // kernel page directory
 static page_dir *kdir;
 
+// page tables for heap slots that fall back to 4 KB pages
+static page_table *table_reserve[KHEAP_TABLE_RESERVE];
+static uint32_t tables_reserved;
+
 // physical end of kernel image
 // defined by linker
 extern void *__end;
@@ -313,22 +395,47 @@ static uintptr_t phys_alloc_addr = (uintptr_t) & __end;
 // if 0, allocate physical memory, otherwise virtual
 static int heap_is_initialized = 0;
 
-static uint32_t alloc(uint32_t size)
+static page_entry *get_page(uint32_t addr, page_dir * dir, int make_table);
+static int new_frame(page_entry * page);
+static int map_heap_slot(uint32_t addr);
+
+/*
+ Bumps the kernel heap, mapping frames for any pages it reaches.
+ Returns 0 if the heap limit or physical memory is exhausted.
+*/
+static uint32_t alloc(uint32_t size, int page_align)
 {
 	static uint32_t heap_addr = KHEAP_BASE;
+	static uint32_t heap_mapped = KHEAP_BASE;
 
 	uint32_t base = heap_addr;
-	heap_addr += size;
+	if (page_align) {
+		base = (base + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+	}
+	if (size > KHEAP_BASE + KHEAP_MAX - base) {
+		return 0;
+	}
 
-	if (heap_addr > KHEAP_BASE + KHEAP_SIZE) {
-		kpanic("Heap is full!");
+	while (heap_mapped < base + size) {
+		if (map_heap_slot(heap_mapped) != 0) {
+			return 0;
+		}
+		if (kdir->tables_phys[heap_mapped / LARGE_PAGE_SIZE] & PDE_LARGE) {
+			heap_mapped = (heap_mapped & ~(LARGE_PAGE_SIZE - 1)) + LARGE_PAGE_SIZE;
+		} else if (new_frame(get_page(heap_mapped, kdir, 0)) != 0) {
+			return 0;
+		} else {
+			heap_mapped += PAGE_SIZE;
+		}
 	}
 
+	heap_addr = base + size;
 	return base;
 }
 
 /*
  Finds and returns a page, allocating a new page table if necessary.
+ Addresses inside a 4 MB page have no page entry and return NULL.
 */
 static page_entry *get_page(uint32_t addr, page_dir * dir, int make_table)
 {
@@ -339,12 +446,19 @@ static page_entry *get_page(uint32_t addr, page_dir * dir, int make_table)
 	if (dir->tables[index]) {
 		return &dir->tables[index]->pages[offset];
 	}
+	if (dir->tables_phys[index] & PDE_LARGE) {
+		return NULL;
+	}
 
 	// create it if necessary
 	if (make_table) {
 		void *phys_addr = NULL;
 		dir->tables[index] =
 		    (page_table *) kmalloc(sizeof(page_table), 1, &phys_addr);
+		if (dir->tables[index] == NULL) {
+			return NULL;
+		}
+		memset(dir->tables[index], 0, sizeof(page_table));
 		dir->tables_phys[index] = ((uintptr_t) phys_addr) | 0x7;	//enable present, writable
 		return &dir->tables[index]->pages[offset];
 	}
@@ -352,18 +466,28 @@ static page_entry *get_page(uint32_t addr, page_dir * dir, int make_table)
 	return NULL;
 }
 
+/*
+ Translates a mapped kernel virtual address to its physical address.
+*/
+static uintptr_t virt_to_phys(uint32_t addr)
+{
+	uint32_t pde = kdir->tables_phys[addr / LARGE_PAGE_SIZE];
+	if (pde & PDE_LARGE) {
+		return (pde & ~(LARGE_PAGE_SIZE - 1)) | (addr & (LARGE_PAGE_SIZE - 1));
+	}
+	page_entry *page = get_page(addr, kdir, 0);
+	return (page->frameaddr * PAGE_SIZE) | (addr & (PAGE_SIZE - 1));
+}
+
 void *kmalloc(uint32_t size, int page_align, void **phys_addr)
 {
 	void *addr = NULL;
 
 	// Allocate on the kernel heap if one has been created
 	if (heap_is_initialized) {
-		addr = (void *)alloc(size);
-		if (phys_addr) {
-			page_entry *page = get_page((uint32_t) addr, kdir, 0);
-			*phys_addr =
-			    (void *)((page->frameaddr * 0x1000) +
-				     ((uintptr_t) addr & 0xFFF));
+		addr = (void *)alloc(size, page_align);
+		if (addr && phys_addr) {
+			*phys_addr = (void *)virt_to_phys((uint32_t) addr);
 		}
 	}
 	// Else, allocate directly from physical memory
@@ -381,41 +505,104 @@ void *kmalloc(uint32_t size, int page_align, void **phys_addr)
 	return addr;
 }
 
-/* Finds the first free page frame */
+// frames released by free_frame(), reused before the bitmap is scanned
+#ifndef FRAME_STACK_SIZE
+#define FRAME_STACK_SIZE 256
+#endif
+static uint32_t frame_stack[FRAME_STACK_SIZE];
+static uint32_t frame_top = 0;
+
+// no bitmap word below this one has a free frame
+static uint32_t next_free_word = 0;
+
+// frames cleared ahead of time by vm_zero_frames(); marked in use
+#ifndef ZERO_POOL_SIZE
+#define ZERO_POOL_SIZE 64
+#endif
+static uint32_t zero_pool[ZERO_POOL_SIZE];
+static uint32_t zero_top = 0;
+
+// a page of kernel address space where frames are mapped to be cleared
+#define ZERO_WINDOW	(KHEAP_BASE - PAGE_SIZE)
+static page_entry *zero_window;
+
+/* Finds a free page frame, starting at the hint and a word at a time */
 static uint32_t find_free(void)
 {
-	uint32_t i, j;
-	for (i = 0; i < NFRAMES / FRAME_BIT; i++)
-		if (frames[i] != 0xFFFFFFFF)	//if frame not full
-			for (j = 0; j < FRAME_BIT; j++)	//find first free bit
-				if (!(frames[i] & (1 << j)))
-					return i * FRAME_BIT + j;
+	if (frame_top > 0) {
+		return frame_stack[--frame_top];
+	}
+
+	for (uint32_t i = next_free_word; i < nwords; i++) {
+		if (frames[i] != 0xFFFFFFFF) {	//if frame not full
+			next_free_word = i;
+			return i * FRAME_BIT + __builtin_ctz(~frames[i]);
+		}
+	}
+	next_free_word = nwords;
 
 	return -1;		//no free frames
 }
 
+/*
+ Finds 4 MB of free frames starting on a 4 MB boundary, marks them in use,
+ and returns the first frame index, or -1 if there is no such run.
+*/
+static uint32_t find_free_large(void)
+{
+	const uint32_t words = LARGE_PAGE_SIZE / PAGE_SIZE / FRAME_BIT;
+
+	for (uint32_t i = 0; i + words <= nwords; i += words) {
+		uint32_t j = 0;
+		while (j < words && frames[i + j] == 0) {
+			j++;
+		}
+		if (j == words) {
+			memset(&frames[i], 0xFF, words * sizeof(*frames));
+			return i * FRAME_BIT;
+		}
+	}
+	return -1;
+}
+
 /* Marks a page frame bit as in use */
 static void set_bit(uint32_t addr)
 {
 	uint32_t frame = addr / PAGE_SIZE;
 	uint32_t index = frame / FRAME_BIT;
 	uint32_t offset = frame % FRAME_BIT;
-	frames[index] |= (1 << offset);
+	if (index < nwords) {
+		frames[index] |= (1 << offset);
+	}
+}
+
+/* Marks a page frame bit as free */
+static void clear_bit(uint32_t addr)
+{
+	uint32_t frame = addr / PAGE_SIZE;
+	uint32_t index = frame / FRAME_BIT;
+	uint32_t offset = frame % FRAME_BIT;
+	if (index < nwords) {
+		frames[index] &= ~(1 << offset);
+	}
 }
 
 /*
  Marks a frame as in use in the frame bitmap, sets up the page,
- and saves the frame index in the page.
+ and saves the frame index in the page. Returns -1 if no frame is free.
 */
-static void new_frame(page_entry * page)
+static int new_frame(page_entry * page)
 {
 	if (page->frameaddr != 0) {
-		return;
+		return 0;
 	}
 
 	uint32_t index = find_free();
+	if (index == (uint32_t) (-1) && zero_top > 0) {
+		index = zero_pool[--zero_top];	// the last free frames may be pooled
+	}
 	if (index == (uint32_t) (-1)) {
-		kpanic("Out of memory");
+		return -1;
 	}
 
 	//mark a frame as in-use
@@ -424,38 +611,319 @@ static void new_frame(page_entry * page)
 	page->frameaddr = index;
 	page->writeable = 1;
 	page->usermode = 0;
+	return 0;
+}
+
+/*
+ Releases the frame behind a page and clears the page. The frame goes on
+ the frame stack if there is room, keeping its bitmap bit set so scans
+ skip it; otherwise its bit is cleared and the hint moved back to it.
+*/
+static void free_frame(page_entry * page)
+{
+	uint32_t index = page->frameaddr;
+	if (!page->present || index == 0) {
+		return;
+	}
+
+	if (frame_top < FRAME_STACK_SIZE) {
+		frame_stack[frame_top++] = index;
+	} else {
+		clear_bit(index * PAGE_SIZE);
+		if (index / FRAME_BIT < next_free_word) {
+			next_free_word = index / FRAME_BIT;
+		}
+	}
+	memset(page, 0, sizeof(*page));
+}
+
+/*
+ Backs the 4 MB heap slot holding addr with a 4 MB page if an aligned run
+ of free frames exists, or else with a reserved page table that alloc()
+ fills one frame at a time. Returns -1 if neither is possible.
+*/
+static int map_heap_slot(uint32_t addr)
+{
+	uint32_t index = addr / LARGE_PAGE_SIZE;
+	if (kdir->tables_phys[index] & PDE_PRESENT) {
+		return 0;
+	}
+
+	uint32_t frame = find_free_large();
+	if (frame != (uint32_t) (-1)) {
+		kdir->tables_phys[index] = frame * PAGE_SIZE | PDE_PRESENT | PDE_WRITE | PDE_LARGE;
+		return 0;
+	}
+
+	if (tables_reserved == 0) {
+		return -1;
+	}
+	// reserved tables are identity mapped, so virtual is physical
+	page_table *table = table_reserve[--tables_reserved];
+	memset(table, 0, sizeof(*table));
+	kdir->tables[index] = table;
+	kdir->tables_phys[index] = (uintptr_t)table | PDE_PRESENT | PDE_WRITE | PDE_USER;
+	return 0;
+}
+
+void page_fault_handler(uint32_t error);
+
+/*
+ Called by page_fault_task with the CPU's error code. A not-present fault
+ inside a process stack commits the page; anything else is fatal.
+*/
+void page_fault_handler(uint32_t error)
+{
+	uint32_t addr;
+	__asm__ volatile ("mov %%cr2,%0" : "=r"(addr));
+
+	if (!(error & 0x1) && stack_fault((void *)addr) == 0) {
+		return;
+	}
+
+	char msg[] = "Page fault at 0x00000000";
+	char *digit = msg + sizeof(msg) - 2;
+	for (uint32_t a = addr; a != 0; a >>= 4) {
+		*digit-- = "0123456789ABCDEF"[a & 0xF];
+	}
+	kpanic(msg);
+}
+
+void vm_memory_map(const struct multiboot_info *mbi)
+{
+	boot_info = mbi;
+}
+
+size_t vm_usable_memory(void)
+{
+	return (size_t)usable_frames * PAGE_SIZE;
+}
+
+/* Counts the set bits in a word */
+static uint32_t bit_count(uint32_t w)
+{
+	w = w - ((w >> 1) & 0x55555555);
+	w = (w & 0x33333333) + ((w >> 2) & 0x33333333);
+	w = (w + (w >> 4)) & 0x0F0F0F0F;
+	return (w * 0x01010101) >> 24;
+}
+
+/*
+ Marks frames [first, last) in use or free, a bitmap word at a time.
+ Returns the number of frames whose state changed.
+*/
+static uint32_t mark_frames(uint32_t first, uint32_t last, int used)
+{
+	uint32_t changed = 0;
+
+	if (last > nwords * FRAME_BIT) {
+		last = nwords * FRAME_BIT;
+	}
+	while (first < last) {
+		uint32_t offset = first % FRAME_BIT;
+		uint32_t n = FRAME_BIT - offset;
+		if (n > last - first) {
+			n = last - first;
+		}
+		uint32_t mask = n == FRAME_BIT ? 0xFFFFFFFF : ((1u << n) - 1) << offset;
+		uint32_t *word = &frames[first / FRAME_BIT];
+
+		changed += bit_count(used ? ~*word & mask : *word & mask);
+		*word = used ? *word | mask : *word & ~mask;
+		first += n;
+	}
+	return changed;
+}
+
+/* Marks the whole frames inside [start, end) as free */
+static void free_range(uint64_t start, uint64_t end)
+{
+	uint64_t first = (start + PAGE_SIZE - 1) >> 12;
+	uint64_t last = end >> 12;
+
+	if (last > nframes) {
+		last = nframes;
+	}
+	if (first < last) {
+		usable_frames += mark_frames((uint32_t)first, (uint32_t)last, 0);
+	}
+}
+
+/*
+ Calls fn for each available region the loader reported, or for the
+ default MEM_SIZE bytes if it reported none.
+*/
+static void for_each_region(void (*fn)(uint64_t start, uint64_t end))
+{
+	const struct multiboot_info *mbi = boot_info;
+
+	if (mbi && (mbi->flags & MULTIBOOT_INFO_MMAP)) {
+		uintptr_t p = mbi->mmap_addr;
+		while (p < mbi->mmap_addr + mbi->mmap_length) {
+			const struct multiboot_mmap_entry *e = (const void *)p;
+			if (e->type == MULTIBOOT_MEMORY_AVAILABLE) {
+				fn(e->addr, e->addr + e->len);
+			}
+			p += e->size + sizeof(e->size);
+		}
+	} else if (mbi && (mbi->flags & MULTIBOOT_INFO_MEMORY)) {
+		fn(0, (uint64_t)mbi->mem_lower * 1024);
+		fn(0x100000, 0x100000 + (uint64_t)mbi->mem_upper * 1024);
+	} else {
+		fn(0, MEM_SIZE);
+	}
+}
+
+static uint64_t mem_top;
+
+static void find_top(uint64_t start, uint64_t end)
+{
+	(void)start;
+	if (end > mem_top) {
+		mem_top = end;
+	}
+}
+
+int vm_map_page(void *virt)
+{
+	page_entry *page = get_page((uint32_t) virt, kdir, 1);
+	if (page == NULL || new_frame(page) != 0) {
+		return -1;
+	}
+	__asm__ volatile ("invlpg (%0)" :: "r"(virt) : "memory");
+	return 0;
+}
+
+void vm_unmap_page(void *virt)
+{
+	page_entry *page = get_page((uint32_t) virt, kdir, 0);
+	if (page == NULL) {
+		return;
+	}
+	free_frame(page);
+	__asm__ volatile ("invlpg (%0)" :: "r"(virt) : "memory");
+}
+
+int vm_map_zeroed_page(void *virt)
+{
+	page_entry *page = get_page((uint32_t) virt, kdir, 1);
+	if (page == NULL) {
+		return -1;
+	}
+
+	if (page->frameaddr == 0 && zero_top > 0) {
+		page->present = 1;
+		page->frameaddr = zero_pool[--zero_top];
+		page->writeable = 1;
+		page->usermode = 0;
+		__asm__ volatile ("invlpg (%0)" :: "r"(virt) : "memory");
+		return 0;
+	}
+
+	if (new_frame(page) != 0) {
+		return -1;
+	}
+	__asm__ volatile ("invlpg (%0)" :: "r"(virt) : "memory");
+	memset(virt, 0, PAGE_SIZE);
+	return 0;
+}
+
+unsigned int vm_zero_frames(unsigned int max)
+{
+	unsigned int n = 0;
+
+	if (zero_window == NULL) {
+		return 0;
+	}
+	while (n < max && zero_top < ZERO_POOL_SIZE) {
+		uint32_t index = find_free();
+		if (index == (uint32_t) (-1)) {
+			break;
+		}
+		set_bit(index * PAGE_SIZE);
+
+		zero_window->present = 1;
+		zero_window->frameaddr = index;
+		zero_window->writeable = 1;
+		__asm__ volatile ("invlpg (%0)" :: "r"(ZERO_WINDOW) : "memory");
+		memset((void *)ZERO_WINDOW, 0, PAGE_SIZE);
+
+		zero_pool[zero_top++] = index;
+		n++;
+	}
+	memset(zero_window, 0, sizeof(*zero_window));
+	__asm__ volatile ("invlpg (%0)" :: "r"(ZERO_WINDOW) : "memory");
+	return n;
 }
 
 void vm_init(void)
 {
+	// size the frame bitmap to the highest usable address below 4 GB,
+	// with every frame in use except those in available regions
+	for_each_region(find_top);
+	if (mem_top > 0x100000000ULL) {
+		mem_top = 0x100000000ULL;
+	}
+	nframes = (uint32_t)(mem_top >> 12);
+	nwords = (nframes + FRAME_BIT - 1) / FRAME_BIT;
+	frames = kmalloc(nwords * sizeof(*frames), 0, NULL);
+	memset(frames, 0xFF, nwords * sizeof(*frames));
+	for_each_region(free_range);
+
 	// create kernel directory
 	kdir = kmalloc(sizeof(*kdir), 1, 0);	//page aligned
 	memset(kdir, 0, sizeof(*kdir));
+	kernel_tss.cr3 = fault_tss.cr3 = (uintptr_t)&kdir->tables_phys[0];
 
-	// get pages for kernel heap
-	for (uint32_t i = KHEAP_BASE; i < (KHEAP_BASE + KHEAP_SIZE); i += 1) {
-		get_page(i, kdir, 1);
+	// set aside page tables for heap slots that find no free 4 MB run;
+	// the heap itself is mapped as kmalloc() reaches it
+	for (tables_reserved = 0; tables_reserved < KHEAP_TABLE_RESERVE; tables_reserved++) {
+		table_reserve[tables_reserved] = kmalloc(sizeof(page_table), 1, 0);
 	}
 
+	// the page vm_zero_frames() clears frames through
+	zero_window = get_page(ZERO_WINDOW, kdir, 1);
+
 	// perform identity mapping of used memory
-	// note: placement_addr gets incremented in get_page,
-	// so we're mapping the first frames as well
-	for (uint32_t i = 0; i < (phys_alloc_addr + 0x10000); i += PAGE_SIZE) {
-		new_frame(get_page(i, kdir, 1));
+	// note: the first page table is taken from placement memory, so it
+	// is created before the end of the identity region is fixed. The
+	// first 4 MB uses 4 KB pages so that page 0 can be left unmapped;
+	// the table is filled directly rather than through get_page().
+	get_page(0, kdir, 1);
+	page_table *low = kdir->tables[0];
+	uint32_t ident_end = (phys_alloc_addr + 0x10000 + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+	for (uint32_t i = 0; i < LARGE_PAGE_SIZE && i < ident_end; i += PAGE_SIZE) {
+		page_entry *page = &low->pages[i / PAGE_SIZE];
+		page->present = 1;
+		page->frameaddr = i / PAGE_SIZE;
+		page->writeable = 1;
+		page->usermode = 0;
 	}
 
-	// allocate heap frames now that the placement addr has increased.
-	// placement addr increases here for heap
-	for (uint32_t i = KHEAP_BASE; i < (KHEAP_BASE + KHEAP_SIZE); i += PAGE_SIZE) {
-		new_frame(get_page(i, kdir, 1));
+	// anything above that is mapped with 4 MB pages
+	for (uint32_t i = LARGE_PAGE_SIZE; i < ident_end; i += LARGE_PAGE_SIZE) {
+		kdir->tables_phys[i / LARGE_PAGE_SIZE] = i | PDE_PRESENT | PDE_WRITE | PDE_LARGE;
 	}
 
+	// the frames of the whole identity region, in bulk
+	uint32_t ident_frames = ident_end / PAGE_SIZE;
+	if (ident_end > LARGE_PAGE_SIZE) {
+		ident_frames = (ident_end + LARGE_PAGE_SIZE - 1) / LARGE_PAGE_SIZE * (LARGE_PAGE_SIZE / PAGE_SIZE);
+	}
+	mark_frames(0, ident_frames, 1);
+
 	// generate a page fault for NULL pointer dereference
 	memset(&kdir->tables[0]->pages[0], 0, sizeof(kdir->tables[0]->pages[0]));
 
 	// load the kernel page directory
 	__asm__ volatile ("mov %0,%%cr3" :: "b"(&kdir->tables_phys[0]));
 
+	// allow 4 MB pages
+	uint32_t cr4;
+	__asm__ volatile ("mov %%cr4,%0" : "=b"(cr4));
+	cr4 |= 0x10;
+	__asm__ volatile ("mov %0,%%cr4" :: "b"(cr4));
+
 	// enable paging
 	uint32_t cr0;
 	__asm__ volatile ("mov %%cr0,%0" : "=b"(cr0));
@@ -0,0 +1,17 @@
+#include <mpx/idle.h>
+#include <mpx/serial.h>
+#include <mpx/vm.h>
+#include <sys_req.h>
+#include <string.h>
+
+void idle_process(void) {
+    char msg[] = "IDLE PROCESS EXECUTING.\r\n";
+
+    for (;;) {
+        sys_write(COM1, msg, strlen(msg));
+        // Only reached when nothing else is ready. This is the process's own
+        // time slice and interrupts are on, so the clearing delays no one.
+        vm_zero_frames(IDLE_ZERO_FRAMES);
+        sys_req(IDLE);
+    }
+}
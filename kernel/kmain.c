@@ -2,19 +2,57 @@
 #include <mpx/interrupts.h>
 #include <mpx/serial.h>
 #include <mpx/vm.h>
+#include <mpx/multiboot.h>
+#include <mpx/timer.h>
+#include <mpx/arena.h>
+#include <mpx/idle.h>
+#include <mpx/panic.h>
 #include <sys_req.h>
 #include <string.h>
 #include <memory.h>
+#include <buddy.h>
 #include <pcb.h>
 #include <pcbuser.h>
 #include <context.h>
 #include <processes.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <cmdHandler.h>
-#include <processes.h>
+#include <sys_call.h>
+#include <time_page.h>
 #include "serial_io.h"
 
 
+// Bytes handed to the dynamic memory manager at boot, room for several
+// hundred PCBs; its frames are mapped as the kernel heap grows into it.
+// Override with -DHEAP_SIZE=...; it has to fit within KHEAP_MAX.
+#ifndef HEAP_SIZE
+#define HEAP_SIZE 0x400000
+#endif
+
+// Non-zero to use the buddy heap instead of the MCB heap. Chosen at boot
+// with heap=buddy or heap=mcb on the kernel command line (qemu -append);
+// building with -DHEAP_BUDDY only changes the default.
+#ifdef HEAP_BUDDY
+static int use_buddy = 1;
+#else
+static int use_buddy = 0;
+#endif
+
+// Longest kernel command line option that is recognized
+#define MAX_OPTION 16
+
+// Most boot stages boot_stamp() can record
+#define MAX_BOOT_STAGES 12
+
+// TSC value at the end of each boot stage, for the boot summary
+static struct {
+    const char *name;
+    uint64_t tsc;
+} boot_stages[MAX_BOOT_STAGES];
+static int boot_stage_count = 0;
+static uint64_t boot_start_tsc;
+
 void init_comhand_process(void);       // Function prototype for initializing command handler process
 void init_system_idle_process(void);   // Function prototype for initializing system idle process
 
@@ -26,6 +64,42 @@ static void klogv(device dev, const char *msg) {
     serial_out(dev, "\r\n", 2);              // Outputs newline
 }
 
+// Records the end of a boot stage
+static void boot_stamp(const char *name) {
+    if (boot_stage_count < MAX_BOOT_STAGES) {
+        boot_stages[boot_stage_count].name = name;
+        boot_stages[boot_stage_count].tsc = rdtsc();
+        boot_stage_count++;
+    }
+}
+
+// Logs how long each boot stage took, in microseconds once the timer has
+// measured the TSC rate, and in thousands of cycles before that
+static void boot_summary(void) {
+    uint32_t cycles_per_us = kernel_time_page.tsc_per_tick / (1000000 / TIMER_HZ);
+    uint64_t prev = boot_start_tsc;
+    char line[80];
+
+    klogv(COM1, "Boot summary:");
+    for (int i = 0; i < boot_stage_count; i++) {
+        uint32_t cycles = (uint32_t)(boot_stages[i].tsc - prev);
+        prev = boot_stages[i].tsc;
+        if (cycles_per_us) {
+            sprintf(line, "  %s: %d us", boot_stages[i].name, (int)(cycles / cycles_per_us));
+        } else {
+            sprintf(line, "  %s: %d kcycles", boot_stages[i].name, (int)(cycles >> 10));
+        }
+        klogv(COM1, line);
+    }
+    uint32_t total = (uint32_t)(prev - boot_start_tsc);
+    if (cycles_per_us) {
+        sprintf(line, "  total: %d us", (int)(total / cycles_per_us));
+    } else {
+        sprintf(line, "  total: %d kcycles", (int)(total >> 10));
+    }
+    klogv(COM1, line);
+}
+
 // Outputs startup logo sequence
 void startup_sequence(void) {
     char logo[] = "\n\n  \033[0;34m====\033[0;37m\n /    \\\n/      \\\n|      |\n| \033[0;31mFIJI\033[0;37m |\n|      |\n|      |\n|______|\n\n";
@@ -72,7 +146,7 @@ void init_system_idle_process(void) {
     ctx->cs = 0x08; ctx->ds = 0x10; ctx->es = 0x10; ctx->fs = 0x10; ctx->gs = 0x10; ctx->ss = 0x10;
     ctx->ebp = (int)systemIdle->stack;
     ctx->esp = (int)systemIdle->stack_pointer;
-    ctx->eip = (int)sys_idle_process; // Set instruction pointer to system idle process function
+    ctx->eip = (int)idle_process; // Set instruction pointer to system idle process function
     ctx->eflags = 0x0202; // Set flags
     // Initializing general-purpose registers
     ctx->eax = 0x00; ctx->ebx = 0x00; ctx->ecx = 0x00; ctx->edx = 0x00; ctx->esi = 0x00; ctx->edi = 0x00;
@@ -82,8 +156,35 @@ void init_system_idle_process(void) {
 
 
 
-void kmain(void)
+// Applies the options among the space-separated words of the command line
+static void parse_cmdline(const char *cmdline) {
+    char word[MAX_OPTION];
+
+    while (*cmdline) {
+        size_t n = 0;
+        while (*cmdline && *cmdline != ' ') {
+            if (n < sizeof(word) - 1) {
+                word[n] = *cmdline;
+            }
+            n++;
+            cmdline++;
+        }
+        word[n < sizeof(word) ? n : sizeof(word) - 1] = '\0';
+        if (n < sizeof(word) && strcmp(word, "heap=buddy") == 0) {
+            use_buddy = 1;
+        } else if (n < sizeof(word) && strcmp(word, "heap=mcb") == 0) {
+            use_buddy = 0;
+        }
+        while (*cmdline == ' ') {
+            cmdline++;
+        }
+    }
+}
+
+void kmain(uint32_t magic, struct multiboot_info *mbi)
 {
+    boot_start_tsc = rdtsc();
+
     // 0) Serial I/O -- <mpx/serial.h>
     // If we don't initialize the serial port, we have no way of
     // performing I/O. So we need to do that before anything else so we
@@ -94,6 +195,7 @@ void kmain(void)
 
 
     serial_init(COM1);
+    boot_stamp("serial");
     //serial_out(COM1, buffer, len);
     klogv(COM1, "Initialized serial I/O on COM1 device...");
 
@@ -103,6 +205,7 @@ void kmain(void)
     // interrupts can be configured.
     klogv(COM1, "Initializing Global Descriptor Table...");
     gdt_init();
+    boot_stamp("GDT");
 
     // 2) Interrupt Descriptor Table (IDT) -- <mpx/interrupts.h>
     // Keeps track of where the various Interrupt Vectors are stored. It
@@ -110,6 +213,7 @@ void kmain(void)
     // be installed.
     klogv(COM1, "Initializing Interrupt Descriptor Table...");
     idt_init();
+    boot_stamp("IDT");
 
 
     // 3) Disable Interrupts -- <mpx/interrupts.h>
@@ -125,6 +229,7 @@ void kmain(void)
     irq_init();
     idt_install(0x24, serial_interrupt_wrapper);
     idt_install(0x23, serial_interrupt_wrapper);
+    boot_stamp("IRQ");
 
 
     // 5) Programmable Interrupt Controller (PIC) -- <mpx/interrupts.h>
@@ -133,6 +238,13 @@ void kmain(void)
     // then handle via the IDT and its list of ISRs.
     klogv(COM1, "Initializing Programmable Interrupt Controller...");
     pic_init();
+    boot_stamp("PIC");
+
+    // 5a) Programmable Interval Timer -- <mpx/timer.h>
+    // Drives the tick count and wall-clock time in the shared time page.
+    klogv(COM1, "Initializing system timer...");
+    timer_init();
+    boot_stamp("timer");
 
     // 6) Reenable interrupts -- <mpx/interrupts.h>
     // Now that interrupt routines are set up, allow interrupts to happen
@@ -150,12 +262,36 @@ void kmain(void)
     // Page Tables, data structures that describe the logical-to-physical
     // mapping as well as manage permissions and other metadata.
     klogv(COM1, "Initializing Virtual Memory...");
+    if (magic == MULTIBOOT_BOOTLOADER_MAGIC && (mbi->flags & MULTIBOOT_INFO_CMDLINE)) {
+        parse_cmdline((const char *)mbi->cmdline); // Still reachable by its physical address
+    }
+    vm_memory_map(magic == MULTIBOOT_BOOTLOADER_MAGIC ? mbi : NULL);
     vm_init();
+    boot_stamp("VM");
+    char mem_msg[64];
+    sprintf(mem_msg, "Usable memory: %d MB", (int)(vm_usable_memory() >> 20));
+    klogv(COM1, mem_msg);
 
     // 8) MPX Modules -- *headers vary*
     // Module specific initialization -- not all modules require this.
     klogv(COM1, "Initializing MPX modules...");
-    // R5: sys_set_heap_functions(...);
+    if (use_buddy) {
+        // Buddy heap; its pool is the largest power of two within HEAP_SIZE
+        klogv(COM1, "Initializing buddy heap...");
+        if (buddy_init(HEAP_SIZE) != 0) {
+            // Without it every allocation would come from kmalloc() and never be freed
+            kpanic("The kernel heap cannot hold HEAP_SIZE bytes");
+        }
+        arena_init(buddy_alloc, buddy_free);
+    } else {
+        klogv(COM1, "Initializing MCB heap...");
+        if (initialize_heap(HEAP_SIZE) != 0) {
+            kpanic("The kernel heap cannot hold HEAP_SIZE bytes");
+        }
+        arena_init(allocate_memory, free_memory);
+    }
+    sys_call_init();
+    boot_stamp("modules");
     // R4: create commhand and idle processes
 
     // 9) YOUR command handler -- *create and #include an appropriate .h file*
@@ -171,6 +307,8 @@ void kmain(void)
     //comhand();
     init_system_idle_process();
     init_comhand_process();
+    boot_stamp("processes");
+    boot_summary();
     
     startup_sequence();
     
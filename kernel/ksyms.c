@@ -0,0 +1,20 @@
+#include <mpx/ksyms.h>
+#include <stddef.h>
+
+const char *ksym_lookup(uintptr_t addr, uintptr_t *offset) {
+    // Binary search for the last symbol at or below addr
+    unsigned int lo = 0, hi = nksyms;
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+        if (ksyms[mid].addr <= addr) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return NULL;
+    }
+    *offset = addr - ksyms[lo - 1].addr;
+    return ksyms[lo - 1].name;
+}
@@ -0,0 +1,85 @@
+#include <mpx/kthread.h>
+#include <memory.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+static struct kthread *kthreads = NULL;        // Run list of all workers
+static struct kthread *current_kthread = NULL; // Worker currently on the CPU
+static void *dispatcher_esp = NULL;            // Where kthread_run() was switched out
+
+// First code a new worker runs; reached through the ret in kthread_switch
+static void kthread_entry(void) {
+    current_kthread->fn(current_kthread->arg);
+    current_kthread->state = KTHREAD_DEAD; // Released by kthread_run()
+    kthread_yield();
+}
+
+struct kthread *kthread_create(const char *name, void (*fn)(void *), void *arg) {
+    struct kthread *thread = sys_alloc_mem(sizeof(struct kthread));
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->stack = sys_alloc_mem(KTHREAD_STACK_SIZE);
+    if (thread->stack == NULL) {
+        sys_free_mem(thread);
+        return NULL;
+    }
+
+    strncpy(thread->name, name, sizeof(thread->name) - 1);
+    thread->name[sizeof(thread->name) - 1] = '\0';
+    thread->state = KTHREAD_READY;
+    thread->fn = fn;
+    thread->arg = arg;
+
+    // Lay out the frame kthread_switch() pops: edi, esi, ebx, ebp, return address
+    uint32_t *sp = (uint32_t *)(thread->stack + KTHREAD_STACK_SIZE);
+    *--sp = 0;                         // Fake return address for kthread_entry
+    *--sp = (uint32_t)kthread_entry;   // Where kthread_switch() returns to
+    *--sp = 0;                         // ebp
+    *--sp = 0;                         // ebx
+    *--sp = 0;                         // esi
+    *--sp = 0;                         // edi
+    thread->esp = sp;
+
+    thread->next = kthreads;
+    kthreads = thread;
+    return thread;
+}
+
+void kthread_yield(void) {
+    kthread_switch(&current_kthread->esp, dispatcher_esp);
+}
+
+void kthread_wait(void) {
+    current_kthread->state = KTHREAD_WAITING;
+    kthread_yield();
+}
+
+void kthread_wake(struct kthread *thread) {
+    if (thread && thread->state == KTHREAD_WAITING) {
+        thread->state = KTHREAD_READY;
+    }
+}
+
+void kthread_run(void) {
+    struct kthread **link = &kthreads;
+
+    while (*link != NULL) {
+        struct kthread *thread = *link;
+
+        if (thread->state == KTHREAD_READY) {
+            current_kthread = thread;
+            kthread_switch(&dispatcher_esp, thread->esp);
+            current_kthread = NULL;
+        }
+
+        if (thread->state == KTHREAD_DEAD) {
+            *link = thread->next; // Unlink and release finished workers
+            sys_free_mem(thread->stack);
+            sys_free_mem(thread);
+            continue;
+        }
+        link = &thread->next;
+    }
+}
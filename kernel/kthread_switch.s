@@ -0,0 +1,27 @@
+bits 32
+global kthread_switch
+
+;;; Switches between kernel worker threads and the dispatcher.
+;;; void kthread_switch(void **save_esp, void *load_esp)
+;;; Only the callee-saved registers are kept; the C calling convention
+;;; makes the caller responsible for everything else.
+
+section .text
+kthread_switch:
+    mov eax, [esp+4]     ; Where to save the current stack pointer
+    mov edx, [esp+8]     ; Stack pointer to switch to
+
+    push ebp             ; Save callee-saved registers on the old stack
+    push ebx
+    push esi
+    push edi
+
+    mov [eax], esp       ; Remember where the old stack stopped
+    mov esp, edx         ; Switch stacks
+
+    pop edi              ; Restore callee-saved registers from the new stack
+    pop esi
+    pop ebx
+    pop ebp
+
+    ret                  ; Resume wherever the new stack left off
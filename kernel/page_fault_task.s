@@ -0,0 +1,18 @@
+bits 32
+global page_fault_task
+
+;;; Page fault handler task.
+;;; Interrupt 14 goes through a task gate, so this always runs on its own
+;;; stack with its own TSS, even when the fault was a push onto an
+;;; unmapped process stack page. The CPU pushes the error code onto this
+;;; stack; iret switches back to the faulting task, which retries the
+;;; access. The next page fault resumes this task after the iret.
+
+extern page_fault_handler
+
+section .text
+page_fault_task:
+    call page_fault_handler ; Takes the error code on top of the stack as its argument
+    add esp, 4              ; Drop the error code pushed by the CPU
+    iret                    ; Back to the faulting task
+    jmp page_fault_task     ; The next fault continues here
@@ -1,15 +1,30 @@
 #include "pcb.h"
 #include "memory.h"
 #include <context.h>
+#include <sys_call.h>
 #include <string.h>
 #include <sys_req.h>
+#include <mpx/slab.h>
+#include <mpx/stack.h>
+#include <mpx/arena.h>
 
 #define COM1 0x3F8
 
+// Slots in each lookup table; a power of two, twice the most PCBs allowed
+#define PCB_TABLE_SIZE 512
+#define PCB_TABLE_MASK (PCB_TABLE_SIZE - 1)
+#define PCB_MAX (PCB_TABLE_SIZE / 2)
+
 
 struct pcb *ReadyQueue = NULL;   // Pointer to the head of the Ready Queue
 struct pcb *BlockedQueue = NULL; // Pointer to the head of the Blocked Queue
 
+static int next_pid = 1;         // PID handed to the next allocated PCB
+static struct kmem_cache *pcb_cache = NULL; // Object cache all PCBs come from
+static struct pcb *by_name[PCB_TABLE_SIZE]; // Set up PCBs, open-addressed by name_hash
+static struct pcb *by_pid[PCB_TABLE_SIZE];  // The same PCBs, open-addressed by PID
+static int registered = 0;                  // PCBs in the tables
+
 // Writes detailed error messages to a serial port
 void detailed_error(const char *message, const char *variable_name, int value) {
     char buffer[512];
@@ -17,15 +32,83 @@ void detailed_error(const char *message, const char *variable_name, int value) {
     sys_req(WRITE, COM1, buffer, strlen(buffer)); // Send error message to COM1
 }
 
+// FNV-1a hash of a process name
+static uint32_t pcb_hash(const char *name) {
+    uint32_t hash = 2166136261u;
+    while (*name) {
+        hash = (hash ^ (uint8_t)*name++) * 16777619u;
+    }
+    return hash;
+}
+
+// Where a PCB's probe starts in one of the lookup tables
+static uint32_t table_key(struct pcb **table, const struct pcb *pcb) {
+    return table == by_name ? pcb->name_hash : (uint32_t)pcb->pid;
+}
+
+// Adds a PCB to a lookup table, which always has a free slot
+static void table_add(struct pcb **table, struct pcb *pcb) {
+    uint32_t i = table_key(table, pcb) & PCB_TABLE_MASK;
+    while (table[i] != NULL) {
+        i = (i + 1) & PCB_TABLE_MASK;
+    }
+    table[i] = pcb;
+}
+
+// Removes a PCB from a lookup table, shifting later entries back so no probe breaks
+static int table_del(struct pcb **table, struct pcb *pcb) {
+    uint32_t hole = table_key(table, pcb) & PCB_TABLE_MASK;
+    while (table[hole] != pcb) {
+        if (table[hole] == NULL) {
+            return -1; // Never registered
+        }
+        hole = (hole + 1) & PCB_TABLE_MASK;
+    }
+    for (uint32_t i = (hole + 1) & PCB_TABLE_MASK; table[i] != NULL; i = (i + 1) & PCB_TABLE_MASK) {
+        uint32_t home = table_key(table, table[i]) & PCB_TABLE_MASK;
+        if (((i - home) & PCB_TABLE_MASK) >= ((i - hole) & PCB_TABLE_MASK)) {
+            table[hole] = table[i]; // Its probe passes the hole, so it may move into it
+            hole = i;
+        }
+    }
+    table[hole] = NULL;
+    return 0;
+}
+
+// Finds a set up PCB by name, whether it is queued or running
+static struct pcb *lookup_name(const char *name) {
+    uint32_t hash = pcb_hash(name);
+    for (uint32_t i = hash & PCB_TABLE_MASK; by_name[i] != NULL; i = (i + 1) & PCB_TABLE_MASK) {
+        if (by_name[i]->name_hash == hash && strcmp(by_name[i]->name, name) == 0) {
+            return by_name[i];
+        }
+    }
+    return NULL;
+}
+
+// Runs once per PCB when the cache takes a new slab; pcb_free() restores this state
+static void pcb_ctor(void *obj) {
+    memset(obj, 0, sizeof(struct pcb));
+}
+
 // Allocates memory for a new PCB and initializes its stack
 struct pcb* pcb_allocate(void) {
-    struct pcb *new_pcb = (struct pcb*) sys_alloc_mem(sizeof(struct pcb)); // Allocate memory for new PCB
+    if (pcb_cache == NULL) {
+        pcb_cache = kmem_cache_create("pcb", sizeof(struct pcb), PCB_ALIGN, pcb_ctor);
+    }
+    struct pcb *new_pcb = (struct pcb*) kmem_cache_alloc(pcb_cache); // Take a constructed PCB from the cache
     if (new_pcb == NULL) {
         detailed_error("Error: Failed to allocate memory for new PCB.", NULL, 0);
         return NULL;
     }
-    memset(new_pcb->stack, 0, 6700); // Initialize stack with zeros
-    new_pcb->stack_pointer = (void*)(new_pcb->stack + 6700 - sizeof(struct context)); // Set stack pointer
+    new_pcb->stack = stack_alloc(new_pcb->name); // Only the top page is committed up front
+    if (new_pcb->stack == NULL) {
+        detailed_error("Error: Failed to allocate a stack for new PCB.", NULL, 0);
+        kmem_cache_free(pcb_cache, new_pcb);
+        return NULL;
+    }
+    new_pcb->pid = next_pid++;       // Assign a unique process identifier; the rest starts zeroed
+    new_pcb->stack_pointer = (void*)(new_pcb->stack + STACK_SIZE - sizeof(struct context)); // Set stack pointer
     return new_pcb;
 }
 
@@ -35,53 +118,96 @@ int pcb_free(struct pcb *pcb_to_free) {
         detailed_error("Error: Attempted to free a NULL PCB.", NULL, 0);
         return -1;
     }
-    sys_free_mem(pcb_to_free->stack); // Free the stack memory
-    sys_free_mem(pcb_to_free);        // Free the PCB structure
+    if (!kmem_cache_owns(pcb_cache, pcb_to_free)) { // Leave anything else untouched
+        detailed_error("Error: Attempted to free a PCB that is not allocated.", NULL, 0);
+        return -1;
+    }
+    pcb_unregister(pcb_to_free);
+    char *stack = pcb_to_free->stack;
+    struct arena *arena = pcb_to_free->arena;
+    pcb_ctor(pcb_to_free); // The cache hands it out again exactly as it is returned
+    kmem_cache_free(pcb_cache, pcb_to_free);
+    stack_free(stack); // Releases every page the process committed
+    arena_release(&arena); // And everything it allocated, in one go
     return 0;
 }
 
+// Takes a PCB out of the lookup tables, so its name may be used again and
+// nothing can find it while it waits to be freed
+void pcb_unregister(struct pcb *pcb) {
+    if (table_del(by_name, pcb) == 0) {
+        table_del(by_pid, pcb);
+        registered--;
+    }
+}
+
 // Sets up a new PCB with specified name, class, and priority
 struct pcb* pcb_setup(const char *name, int class, int priority) {
     if (name == NULL || strlen(name) < 1 || strlen(name) > 15 || priority < 0 || priority > 9) {
         detailed_error("Error: Invalid PCB setup parameters.", "Priority", priority);
         return NULL;
     }
+    if (lookup_name(name) != NULL) {
+        detailed_error("Error: PCB name is already in use.", NULL, 0);
+        return NULL;
+    }
+    if (registered >= PCB_MAX) {
+        detailed_error("Error: Too many PCBs.", "Max", PCB_MAX);
+        return NULL;
+    }
     struct pcb *new_pcb = pcb_allocate(); // Allocate a new PCB
     if (new_pcb == NULL) {
         return NULL;
     }
     strncpy(new_pcb->name, name, 15); // Copy the name to the PCB
     new_pcb->name[15] = '\0';         // Ensure null termination
+    new_pcb->name_hash = pcb_hash(new_pcb->name); // Lets lookups skip PCBs without reading their names
+    table_add(by_name, new_pcb); // Findable by name and PID until it exits or is freed
+    table_add(by_pid, new_pcb);
+    registered++;
     new_pcb->class = class;           // Set class
     new_pcb->priority = priority;     // Set priority
     new_pcb->exec_state = READY;      // Set execution state to READY
     new_pcb->disp_state = NOT_SUSPENDED; // Set dispatch state to NOT_SUSPENDED
-    new_pcb->stack_pointer = &new_pcb->stack[6700] - sizeof(struct context); // Adjust stack pointer
+    new_pcb->stack_pointer = &new_pcb->stack[STACK_SIZE] - sizeof(struct context); // Adjust stack pointer
     new_pcb->stack_pointer = (struct context *)new_pcb->stack_pointer;       // Cast to context pointer
     memset(new_pcb->stack_pointer, 0, sizeof(struct context)); // Initialize context to zeros
     return new_pcb;
 }
 
+// Initializes the saved context so the process starts executing at entry
+void pcb_set_context(struct pcb *pcb, void (*entry)(void)) {
+    struct context *ctx = (struct context *)pcb->stack_pointer;
+    ctx->cs = 0x08; ctx->ds = 0x10; ctx->es = 0x10; ctx->fs = 0x10; ctx->gs = 0x10; ctx->ss = 0x10;
+    ctx->ebp = (int)pcb->stack;
+    ctx->esp = (int)pcb->stack_pointer;
+    ctx->eip = (int)entry;  // Start executing at the entry function
+    ctx->eflags = 0x0202;   // Interrupts enabled
+    ctx->eax = 0x00; ctx->ebx = 0x00; ctx->ecx = 0x00; ctx->edx = 0x00; ctx->esi = 0x00; ctx->edi = 0x00;
+}
+
 // Finds a PCB in either the Ready or Blocked queue based on its name
 struct pcb* pcb_find(const char *name) {
     if (!name) {
         detailed_error("Error: Attempted to find PCB with NULL name.", NULL, 0);
         return NULL;
     }
-    struct pcb *current = ReadyQueue; // Start searching in ReadyQueue
-    while (current) {
-        if (strcmp(current->name, name) == 0) return current; // Return PCB if name matches
-        current = current->next; // Move to next PCB in queue
-    }
-    current = BlockedQueue; // Search in BlockedQueue
-    while (current) {
-        if (strcmp(current->name, name) == 0) return current; // Return PCB if name matches
-        current = current->next; // Move to next PCB in queue
-    }
+    struct pcb *found = lookup_name(name);
+    if (found && found != current_pcb) return found; // The running PCB is in neither queue
     detailed_error("Error: PCB not found in any queue. Searched for:", "Name", (int) *name);
     return NULL;
 }
 
+// Finds a PCB in either the Ready or Blocked queue based on its PID
+struct pcb* pcb_find_pid(int pid) {
+    for (uint32_t i = (uint32_t)pid & PCB_TABLE_MASK; by_pid[i] != NULL; i = (i + 1) & PCB_TABLE_MASK) {
+        if (by_pid[i]->pid == pid) {
+            return by_pid[i] != current_pcb ? by_pid[i] : NULL;
+        }
+    }
+    return NULL;
+}
+
 // Inserts a PCB into the appropriate queue based on its execution state
 void pcb_insert(struct pcb* inserted) {
     if (!inserted) {
@@ -2,22 +2,6 @@
 #include <mpx/serial.h>
 #include <sys_req.h>
 
-// Enum for UART (Universal Asynchronous Receiver-Transmitter) registers
-enum uart_registers {
-    RBR = 0,    // Receive Buffer Register (Read): Holds received data
-    THR = 0,    // Transmitter Holding Register (Write): Holds data to be transmitted
-    DLL = 0,    // Divisor Latch Low (Read/Write): Lower byte of the baud rate divisor
-    IER = 1,    // Interrupt Enable Register: Controls which interrupts are enabled
-    DLM = 1,    // Divisor Latch High (Read/Write): Upper byte of the baud rate divisor
-    IIR = 2,    // Interrupt Identification Register (Read): Identifies which interrupt is pending
-    FCR = 2,    // FIFO Control Register (Write): Controls the FIFO buffer
-    LCR = 3,    // Line Control Register: Configures data format and control signals
-    MCR = 4,    // Modem Control Register: Controls the modem signals
-    LSR = 5,    // Line Status Register: Indicates the status of data transfer
-    MSR = 6,    // Modem Status Register: Indicates the status of the modem
-    SCR = 7,    // Scratch Register: General purpose register (not used by UART)
-};
-
 static int initialized[4] = { 0 }; // Array to track initialization status of serial devices
 
 // Converts a device enum to a device number
@@ -61,114 +45,118 @@ int serial_out(device dev, const char *buffer, size_t len) {
     return (int)len; // Return the number of bytes written
 }
 
-// Polls a serial device to read data
-int serial_poll(device dev, char *buffer, size_t len) {
-    if (!buffer || len == 0) {
-        return -1; // Invalid input
-    }
+// Starts an empty line that reads into buffer
+void serial_line_init(struct serial_line *line, char *buffer, size_t len) {
+    line->buffer = buffer;
+    line->len = len;
+    line->count = 0;
+    line->cursor = 0;
+    line->escape = 0;
+}
 
-    size_t bytesRead = 0;
-    size_t cursorPos = 0;
-    int is_escape_seq = 0;
+// Takes the characters that have already arrived, without waiting for more
+int serial_line_poll(device dev, struct serial_line *line) {
+    char *buffer = line->buffer;
 
-    while (bytesRead < len - 1) {
-        if (inb(dev + LSR) & 0x01) {
-            char c = inb(dev);
-            if (is_escape_seq) {
-                if (c == '[') {
-                    is_escape_seq++;
-                } else if (is_escape_seq == 2) {
-                    if (c == 'D' && cursorPos > 0) { // Left Arrow
-                        cursorPos--;
-                        char moveLeft[] = {0x1B, '[', 'D'};
-                        serial_out(dev, moveLeft, 3);
-                    } else if (c == 'C' && cursorPos < bytesRead) { // Right Arrow
-                        cursorPos++;
-                        char moveRight[] = {0x1B, '[', 'C'};
-                        serial_out(dev, moveRight, 3);
-                    } else if (c == '3' && inb(dev) == '~') { // Delete Key
-                        if (cursorPos < bytesRead) {
-                            for (size_t i = cursorPos + 1; i < bytesRead; i++) {
-                                buffer[i - 1] = buffer[i];
-                            }
-                            bytesRead--;
-                            buffer[bytesRead] = '\0';
-                            char clearLine[] = {0x1B, '[', 'K'};
-                            serial_out(dev, clearLine, 3);
-                            for (size_t i = cursorPos; i < bytesRead; i++) {
-                                serial_out(dev, &buffer[i], 1);
-                            }
-                        }
-                    }
-                    is_escape_seq = 0;
+    while (line->count < line->len - 1 && (inb(dev + LSR) & 0x01)) {
+        char c = inb(dev);
+        if (line->escape == 1) {
+            line->escape = c == '[' ? 2 : 0;
+            continue;
+        }
+        if (line->escape == 2) {
+            line->escape = 0;
+            if (c == 'D' && line->cursor > 0) { // Left Arrow
+                line->cursor--;
+                char moveLeft[] = {0x1B, '[', 'D'};
+                serial_out(dev, moveLeft, 3);
+            } else if (c == 'C' && line->cursor < line->count) { // Right Arrow
+                line->cursor++;
+                char moveRight[] = {0x1B, '[', 'C'};
+                serial_out(dev, moveRight, 3);
+            } else if (c == '3') { // Delete Key, once its '~' arrives
+                line->escape = 3;
+            }
+            continue;
+        }
+        if (line->escape == 3) {
+            line->escape = 0;
+            if (c == '~' && line->cursor < line->count) {
+                for (size_t i = line->cursor + 1; i < line->count; i++) {
+                    buffer[i - 1] = buffer[i];
+                }
+                line->count--;
+                buffer[line->count] = '\0';
+                char clearLine[] = {0x1B, '[', 'K'};
+                serial_out(dev, clearLine, 3);
+                for (size_t i = line->cursor; i < line->count; i++) {
+                    serial_out(dev, &buffer[i], 1);
                 }
-                continue;
             }
-            if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
-                (c >= '0' && c <= '9') || c == ' ' || c == ':' ||
-                c == ';' || c == '.' || c == ',') {
-                // Insert the new character
-                for (size_t i = bytesRead; i > cursorPos; i--) {
-                    buffer[i] = buffer[i - 1];
+            continue;
+        }
+        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+            (c >= '0' && c <= '9') || c == ' ' || c == ':' ||
+            c == ';' || c == '.' || c == ',') {
+            // Insert the new character
+            for (size_t i = line->count; i > line->cursor; i--) {
+                buffer[i] = buffer[i - 1];
+            }
+            buffer[line->cursor] = c;
+            line->cursor++;
+            line->count++;
+            serial_out(dev, &c, 1);
+        } else if (c == 0x08 || c == 0x7F) { // Backspace or Delete (on some terminals)
+            if (line->cursor > 0) {
+                // Remove the character from the buffer
+                for (size_t i = line->cursor; i < line->count; i++) {
+                    buffer[i - 1] = buffer[i];
+                }
+                line->cursor--;
+                line->count--;
+                buffer[line->count] = '\0';
+                // Clear from cursor to end of line
+                char moveLeft[] = {0x1B, '[', 'D'};
+                char clearLine[] = {0x1B, '[', 'K'};
+                serial_out(dev, moveLeft, 3);
+                serial_out(dev, clearLine, 3);
+
+                // Redraw the line after cursor
+                for (size_t i = line->cursor; i < line->count; i++) {
+                    serial_out(dev, &buffer[i], 1);
                 }
-                buffer[cursorPos] = c;
-                cursorPos++;
-                bytesRead++;
-                serial_out(dev, &c, 1);
-            } else if (c == 0x08 || c == 0x7F) { // Backspace or Delete (on some terminals)
-                if (cursorPos > 0) {
-                    // Remove the character from the buffer
-                    for (size_t i = cursorPos; i < bytesRead; i++) {
-                        buffer[i - 1] = buffer[i];
-                    }
-                    cursorPos--;
-                    bytesRead--;
-                    buffer[bytesRead] = '\0';
-                    // Clear from cursor to end of line
-                    char moveLeft[] = {0x1B, '[', 'D'};
-                    char clearLine[] = {0x1B, '[', 'K'};
+                // Move cursor back to original position
+                for (size_t i = line->count; i > line->cursor; i--) {
                     serial_out(dev, moveLeft, 3);
-                    serial_out(dev, clearLine, 3);
-
-                    // Redraw the line after cursor
-                    for (size_t i = cursorPos; i < bytesRead; i++) {
-                        serial_out(dev, &buffer[i], 1);
-                    }
-                    // Move cursor back to original position
-                    for (size_t i = bytesRead; i > cursorPos; i--) {
-                        serial_out(dev, moveLeft, 3);
-                    }
                 }
-            } else if (c == 0x1B) { // Start of an Escape Sequence
-                is_escape_seq = 1;
-            } else if (c == '\n' || c == '\r') { // New Line or Carriage Return
-                buffer[bytesRead] = c;
-                bytesRead++;
-                serial_out(dev, &c, 1);
-                break;
             }
+        } else if (c == 0x1B) { // Start of an Escape Sequence
+            line->escape = 1;
+        } else if (c == '\n' || c == '\r') { // New Line or Carriage Return
+            buffer[line->count] = c;
+            line->count++;
+            serial_out(dev, &c, 1);
+            buffer[line->count] = '\0';
+            return 1;
         }
     }
-    buffer[bytesRead] = '\0';
-    return (int) bytesRead;
+    if (line->count >= line->len - 1) {
+        buffer[line->count] = '\0';
+        return 1; // Buffer is full
+    }
+    return 0;
 }
 
+// Polls a serial device to read data
+int serial_poll(device dev, char *buffer, size_t len) {
+    if (!buffer || len == 0) {
+        return -1; // Invalid input
+    }
 
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
-
+    struct serial_line line;
+    serial_line_init(&line, buffer, len);
+    while (!serial_line_poll(dev, &line)) {
+        // Wait for the rest of the line
+    }
+    return (int) line.count;
+}
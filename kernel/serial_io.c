@@ -7,6 +7,7 @@
 #include <mpx/serial.h>
 #include "mpx/device.h"
 #include <memory.h>
+#include <mpx/slab.h>
 
 // Constants
 #ifndef IER_THRE
@@ -30,6 +31,9 @@
 // Array of Device Control Blocks
 DeviceControlBlock devices[MAX_DEVICES];
 
+// Object cache the DCB ring buffers come from
+static struct kmem_cache *ring_buf_cache = NULL;
+
 // Find an existing DCB for a given device
 DeviceControlBlock* get_device(device dev) {
     for (int i = 0; i < MAX_DEVICES; ++i) {
@@ -91,7 +95,10 @@ int serial_open(device dev, int baud_rate) {
                 dcb->buf_index = 0;
                 dcb->start = 0;
                 dcb->end = 149;
-                dcb->ring_buf = (char *) sys_alloc_mem(RING_BUFFER_SIZE);
+                if (ring_buf_cache == NULL) {
+                    ring_buf_cache = kmem_cache_create("ring buffer", RING_BUFFER_SIZE, 0, NULL);
+                }
+                dcb->ring_buf = (char *) kmem_cache_alloc(ring_buf_cache);
                 break;
             }
         }
@@ -136,7 +143,8 @@ int serial_close(device dev) {
     }
 
     current_device->status = PORT_CLOSED; // Set device status to closed
-    sys_free_mem(current_device->ring_buf); // Free allocated memory for the ring buffer
+    memset(current_device->ring_buf, 0, RING_BUFFER_SIZE); // Zeroed, as the cache hands them out
+    kmem_cache_free(ring_buf_cache, current_device->ring_buf); // Return the ring buffer to its cache
 
     cli(); // Disable interrupts
     int mask = inb(0x21); // Read interrupt mask
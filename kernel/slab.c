@@ -0,0 +1,256 @@
+#include <mpx/slab.h>
+#include <mpx/vm.h>
+#include <memory.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define SLAB_REGION 0x48000000 // Start of the virtual range slabs are mapped in
+
+// A slab: one page holding this header, a stack of free object indices, an
+// in-use bitmap, then the objects themselves. Keeping the bookkeeping out
+// of the objects is what lets a freed object stay constructed. Slabs are
+// page-aligned, so an object's slab is its address rounded down.
+struct slab {
+    struct kmem_cache *cache; // Cache the slab belongs to
+    struct slab *next;   // Next slab of the same cache
+    struct slab *prev;   // Previous slab, NULL for the first
+    char *objs;          // First object
+    uint16_t nfree;      // Entries on the free stack
+    uint16_t *free;      // Indices of free objects; top is free[nfree - 1]
+    uint32_t *inuse;     // Bit i set while object i is allocated
+};
+
+static struct kmem_cache *caches = NULL; // All caches, for statistics
+static uint32_t slots[SLAB_SLOTS / 32];    // Bit set while a page of the region holds a slab
+
+// Bytes of slab needed to hold n objects of a cache
+static size_t slab_bytes(const struct kmem_cache *cache, unsigned int n) {
+    return sizeof(struct slab) + n * sizeof(uint16_t) + (n + 31) / 32 * sizeof(uint32_t)
+        + (cache->align - 1) + n * cache->size;
+}
+
+struct kmem_cache *kmem_cache_create(const char *name, size_t size, size_t align,
+                                     void (*ctor)(void *)) {
+    if (align < sizeof(void *)) {
+        align = sizeof(void *);
+    }
+    if (size == 0 || (align & (align - 1)) != 0 || align > SLAB_SIZE / 2) {
+        return NULL;
+    }
+
+    struct kmem_cache *cache = sys_alloc_mem(sizeof(struct kmem_cache));
+    if (cache == NULL) {
+        return NULL;
+    }
+    memset(cache, 0, sizeof(*cache));
+    strncpy(cache->name, name, KMEM_NAME_LEN - 1);
+    cache->size = (size + align - 1) & ~(align - 1);
+    cache->align = align;
+    cache->ctor = ctor;
+
+    // As many objects as fit in SLAB_SIZE; there has to be room for one
+    cache->per_slab = 1;
+    if (slab_bytes(cache, 1) > SLAB_SIZE) {
+        sys_free_mem(cache);
+        return NULL;
+    }
+    while (cache->per_slab < UINT16_MAX && slab_bytes(cache, cache->per_slab + 1) <= SLAB_SIZE) {
+        cache->per_slab++;
+    }
+
+    cache->next = caches;
+    caches = cache;
+    return cache;
+}
+
+// Maps a free page of the slab region, or returns NULL. The page reads as
+// zeroes, usually from frames the idle process cleared ahead of time.
+static struct slab *page_alloc(void) {
+    for (uint32_t i = 0; i < SLAB_SLOTS / 32; i++) {
+        if (slots[i] == 0xFFFFFFFF) {
+            continue;
+        }
+        uint32_t slot = i * 32 + __builtin_ctz(~slots[i]);
+        void *page = (void *)(SLAB_REGION + slot * SLAB_SIZE);
+        if (vm_map_zeroed_page(page) != 0) {
+            return NULL;
+        }
+        slots[i] |= (uint32_t)1 << (slot % 32);
+        return page;
+    }
+    return NULL; // The region is full
+}
+
+// Unmaps a slab's page, releasing its frame
+static void page_free(struct slab *slab) {
+    uint32_t slot = ((uintptr_t)slab - SLAB_REGION) / SLAB_SIZE;
+    vm_unmap_page(slab);
+    slots[slot / 32] &= ~((uint32_t)1 << (slot % 32));
+}
+
+// Unlinks a slab from its cache's list
+static void slab_unlink(struct kmem_cache *cache, struct slab *slab) {
+    if (slab->prev != NULL) {
+        slab->prev->next = slab->next;
+    } else {
+        cache->slabs = slab->next;
+    }
+    if (slab->next != NULL) {
+        slab->next->prev = slab->prev;
+    }
+}
+
+// Links a slab in after prev, or first if prev is NULL
+static void slab_link(struct kmem_cache *cache, struct slab *slab, struct slab *prev) {
+    slab->prev = prev;
+    slab->next = prev ? prev->next : cache->slabs;
+    if (slab->next != NULL) {
+        slab->next->prev = slab;
+    }
+    if (prev != NULL) {
+        prev->next = slab;
+    } else {
+        cache->slabs = slab;
+    }
+}
+
+// Takes a new slab page and constructs all of its objects
+static struct slab *cache_grow(struct kmem_cache *cache) {
+    unsigned int n = cache->per_slab;
+
+    struct slab *slab = page_alloc();
+    if (slab == NULL && kmem_cache_shrink(NULL) > 0) {
+        slab = page_alloc(); // Retry now that empty slabs gave their pages back
+    }
+    if (slab == NULL) {
+        return NULL;
+    }
+    slab->cache = cache;
+
+    slab->free = (uint16_t *)(slab + 1);
+    slab->inuse = (uint32_t *)(((uintptr_t)(slab->free + n) + 3) & ~(uintptr_t)3);
+    uintptr_t objs = (uintptr_t)(slab->inuse + (n + 31) / 32);
+    slab->objs = (char *)((objs + cache->align - 1) & ~(uintptr_t)(cache->align - 1));
+
+    // Stack the indices so the lowest addresses are handed out first. The
+    // page is already zeroed, which covers the in-use bitmap and objects
+    // without a constructor.
+    slab->nfree = n;
+    for (unsigned int i = 0; i < n; i++) {
+        slab->free[n - 1 - i] = i;
+        if (cache->ctor) {
+            cache->ctor(slab->objs + i * cache->size);
+        }
+    }
+
+    slab_link(cache, slab, NULL);
+    cache->nslabs++;
+    cache->grows++;
+    return slab;
+}
+
+void *kmem_cache_alloc(struct kmem_cache *cache) {
+    if (cache == NULL) {
+        return NULL;
+    }
+
+    // Slabs with free objects are kept at the front
+    struct slab *slab = cache->slabs;
+    if (slab == NULL || slab->nfree == 0) {
+        slab = cache_grow(cache);
+        if (slab == NULL) {
+            cache->failures++;
+            return NULL;
+        }
+    }
+
+    unsigned int i = slab->free[--slab->nfree];
+    slab->inuse[i / 32] |= (uint32_t)1 << (i % 32);
+
+    if (slab->nfree == 0 && slab->next != NULL && slab->next->nfree > 0) {
+        // Now full: move it behind the slabs that still have room
+        struct slab *prev = slab->next;
+        while (prev->next != NULL && prev->next->nfree > 0) {
+            prev = prev->next;
+        }
+        slab_unlink(cache, slab);
+        slab_link(cache, slab, prev);
+    }
+
+    cache->in_use++;
+    cache->allocs++;
+    return slab->objs + i * cache->size;
+}
+
+// Slab holding obj, with its index, if obj is an allocated object of cache
+static struct slab *slab_of(struct kmem_cache *cache, const void *obj, unsigned int *index) {
+    uintptr_t p = (uintptr_t)obj;
+    if (cache == NULL || p < SLAB_REGION || p >= SLAB_REGION + SLAB_SLOTS * SLAB_SIZE) {
+        return NULL;
+    }
+
+    struct slab *slab = (struct slab *)(p & ~(uintptr_t)(SLAB_SIZE - 1));
+    uint32_t slot = ((uintptr_t)slab - SLAB_REGION) / SLAB_SIZE;
+    if (!(slots[slot / 32] & ((uint32_t)1 << (slot % 32))) || slab->cache != cache
+        || p < (uintptr_t)slab->objs) {
+        return NULL; // Not from this cache
+    }
+
+    size_t off = p - (uintptr_t)slab->objs;
+    unsigned int i = off / cache->size;
+    if (off % cache->size != 0 || i >= cache->per_slab
+        || !(slab->inuse[i / 32] & ((uint32_t)1 << (i % 32)))) {
+        return NULL; // Not the start of an object, or already free
+    }
+    *index = i;
+    return slab;
+}
+
+int kmem_cache_owns(struct kmem_cache *cache, const void *obj) {
+    unsigned int i;
+    return slab_of(cache, obj, &i) != NULL;
+}
+
+int kmem_cache_free(struct kmem_cache *cache, void *obj) {
+    unsigned int i;
+    struct slab *slab = slab_of(cache, obj, &i);
+    if (slab == NULL) {
+        return -1;
+    }
+    slab->inuse[i / 32] &= ~((uint32_t)1 << (i % 32));
+    slab->free[slab->nfree++] = i;
+
+    if (slab->nfree == 1 && slab->prev != NULL) {
+        // It has room again: move it to the front
+        slab_unlink(cache, slab);
+        slab_link(cache, slab, NULL);
+    }
+
+    cache->in_use--;
+    cache->frees++;
+    return 0;
+}
+
+int kmem_cache_shrink(struct kmem_cache *cache) {
+    int released = 0;
+
+    for (struct kmem_cache *c = cache ? cache : caches; c != NULL; c = cache ? NULL : c->next) {
+        struct slab *slab = c->slabs;
+        while (slab != NULL) {
+            struct slab *next = slab->next;
+            if (slab->nfree == c->per_slab) {
+                slab_unlink(c, slab);
+                page_free(slab);
+                c->nslabs--;
+                released++;
+            }
+            slab = next;
+        }
+    }
+    return released;
+}
+
+struct kmem_cache *kmem_cache_list(void) {
+    return caches;
+}
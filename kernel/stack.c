@@ -0,0 +1,139 @@
+#include <mpx/stack.h>
+#include <mpx/vm.h>
+#include <mpx/panic.h>
+#include <mpx/serial.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#define PAGE_SIZE    0x1000
+#define STACK_REGION 0x40000000                 // Start of the reserved virtual range
+#define SLOT_SIZE    (PAGE_SIZE + STACK_SIZE)   // Guard page, then the stack
+#define STACK_PAGES  (STACK_SIZE / PAGE_SIZE)
+
+static uint32_t slots[STACK_SLOTS / 32];        // Bit set while a slot holds a stack
+static const char *owners[STACK_SLOTS];         // Reported when a stack overflows
+static uint8_t committed[STACK_SLOTS];          // Bit i set once page i (from the bottom) is mapped
+static uint32_t warned[STACK_SLOTS / 32];       // Bit set once stack_check() has warned
+
+// Maps one page of a stack and fills it with the canary. This also covers
+// whatever an earlier owner of the frame left there, so stacks do not take
+// from the zeroed-frame pool: clearing a frame that is about to be
+// overwritten would only waste a pooled frame. Slab pages use the pool.
+static int commit(uint32_t slot, uintptr_t page) {
+    if (vm_map_page((void *)page) != 0) {
+        return -1;
+    }
+    uint32_t *word = (uint32_t *)page;
+    for (uint32_t w = 0; w < PAGE_SIZE / sizeof(uint32_t); w++) {
+        word[w] = STACK_CANARY;
+    }
+    committed[slot] |= 1 << ((page - STACK_REGION - slot * SLOT_SIZE - PAGE_SIZE) / PAGE_SIZE);
+    return 0;
+}
+
+// Slot of a stack returned by stack_alloc(), or STACK_SLOTS if it is not one
+static uint32_t slot_of(const void *stack) {
+    uintptr_t base = (uintptr_t)stack;
+    if (base < STACK_REGION || (base - STACK_REGION) % SLOT_SIZE != PAGE_SIZE) {
+        return STACK_SLOTS;
+    }
+    uint32_t slot = (base - STACK_REGION) / SLOT_SIZE;
+    if (slot >= STACK_SLOTS || !(slots[slot / 32] & ((uint32_t)1 << (slot % 32)))) {
+        return STACK_SLOTS;
+    }
+    return slot;
+}
+
+void *stack_alloc(const char *owner) {
+    for (uint32_t i = 0; i < STACK_SLOTS / 32; i++) {
+        if (slots[i] == 0xFFFFFFFF) {
+            continue;
+        }
+        uint32_t slot = i * 32 + __builtin_ctz(~slots[i]);
+        uintptr_t stack = STACK_REGION + slot * SLOT_SIZE + PAGE_SIZE;
+
+        // The top page holds the initial context, so commit it now
+        committed[slot] = 0;
+        if (commit(slot, stack + STACK_SIZE - PAGE_SIZE) != 0) {
+            return NULL;
+        }
+        slots[i] |= (uint32_t)1 << (slot % 32);
+        warned[i] &= ~((uint32_t)1 << (slot % 32));
+        owners[slot] = owner;
+        return (void *)stack;
+    }
+    return NULL; // Every slot is in use
+}
+
+void stack_free(void *stack) {
+    uintptr_t base = (uintptr_t)stack;
+    uint32_t slot = (base - STACK_REGION) / SLOT_SIZE;
+
+    if (base < STACK_REGION || slot >= STACK_SLOTS) {
+        return;
+    }
+    for (uintptr_t page = base; page < base + STACK_SIZE; page += PAGE_SIZE) {
+        vm_unmap_page((void *)page); // Pages never touched are already unmapped
+    }
+    slots[slot / 32] &= ~((uint32_t)1 << (slot % 32));
+    owners[slot] = NULL;
+    committed[slot] = 0;
+}
+
+int stack_fault(void *addr) {
+    uintptr_t a = (uintptr_t)addr;
+    uint32_t slot = (a - STACK_REGION) / SLOT_SIZE;
+
+    if (a < STACK_REGION || slot >= STACK_SLOTS || !(slots[slot / 32] & ((uint32_t)1 << (slot % 32)))) {
+        return -1;
+    }
+
+    if ((a - STACK_REGION) % SLOT_SIZE < PAGE_SIZE) {
+        char msg[64] = "Stack overflow in process ";
+        strncpy(msg + strlen(msg), owners[slot] ? owners[slot] : "?", 16);
+        kpanic(msg);
+    }
+    if (commit(slot, a & ~(uintptr_t)(PAGE_SIZE - 1)) != 0) {
+        kpanic("Out of memory growing a process stack");
+    }
+    return 0;
+}
+
+size_t stack_usage(const void *stack) {
+    uint32_t slot = slot_of(stack);
+    if (slot == STACK_SLOTS) {
+        return 0;
+    }
+
+    // The lowest word that no longer holds the canary marks the deepest
+    // point reached; pages never committed were never touched
+    for (uint32_t i = 0; i < STACK_PAGES; i++) {
+        if (!(committed[slot] & (1 << i))) {
+            continue;
+        }
+        const uint32_t *word = (const uint32_t *)((const char *)stack + i * PAGE_SIZE);
+        for (uint32_t w = 0; w < PAGE_SIZE / sizeof(uint32_t); w++) {
+            if (word[w] != STACK_CANARY) {
+                return (const char *)stack + STACK_SIZE - (const char *)&word[w];
+            }
+        }
+    }
+    return 0;
+}
+
+void stack_check(const void *stack, const void *sp) {
+    uint32_t slot = slot_of(stack);
+    uint32_t bit = (uint32_t)1 << (slot % 32);
+
+    if (STACK_WARN_BYTES == 0 || slot == STACK_SLOTS || (warned[slot / 32] & bit)) {
+        return;
+    }
+    if ((const char *)sp - (const char *)stack < STACK_WARN_BYTES) {
+        char msg[80] = "Warning: stack nearly full in process ";
+        strncpy(msg + strlen(msg), owners[slot] ? owners[slot] : "?", 16);
+        strcat(msg, "\r\n");
+        serial_out(COM1, msg, strlen(msg));
+        warned[slot / 32] |= bit;
+    }
+}
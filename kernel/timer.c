@@ -0,0 +1,123 @@
+#include <mpx/timer.h>
+#include <mpx/interrupts.h>
+#include <mpx/io.h>
+#include <time_page.h>
+#include <stdint.h>
+
+// PIT ports and input clock
+#define PIT_CHANNEL0 0x40
+#define PIT_COMMAND  0x43
+#define PIT_FREQ     1193182
+
+// Channel 0, lobyte/hibyte, rate generator
+#define PIT_MODE     0x36
+
+// Timer IRQ 0 is remapped to vector 0x20 by pic_init()
+#define TIMER_VECTOR 0x20
+
+#define PIC1 0x20
+#define EOI  0x20
+
+// RTC registers
+#define RTC_INDEX_PORT 0x70
+#define RTC_DATA_PORT  0x71
+#define RTC_SECONDS    0x00
+#define RTC_MINUTES    0x02
+#define RTC_HOURS      0x04
+#define RTC_DAY        0x07
+#define RTC_MONTH      0x08
+#define RTC_YEAR       0x09
+#define RTC_STATUS_A   0x0A
+#define RTC_UIP        0x80 // Status A: an update starts within 244 us or is under way
+
+// The time page, on a page of its own so it can be mapped by itself
+struct time_page kernel_time_page __attribute__((aligned(0x1000)));
+
+// Ticks since the last RTC resync (avoids 64-bit division in the ISR)
+static uint32_t ticks_since_sync = 0;
+
+// Reads and decodes one BCD register from the RTC
+static uint8_t rtc_read(uint8_t reg) {
+    outb(RTC_INDEX_PORT, reg);
+    uint8_t bcd = inb(RTC_DATA_PORT);
+    return ((bcd >> 4) & 0x0F) * 10 + (bcd & 0x0F);
+}
+
+// Reads all six time registers into t
+static void rtc_read_all(uint8_t t[6]) {
+    t[0] = rtc_read(RTC_SECONDS);
+    t[1] = rtc_read(RTC_MINUTES);
+    t[2] = rtc_read(RTC_HOURS);
+    t[3] = rtc_read(RTC_DAY);
+    t[4] = rtc_read(RTC_MONTH);
+    t[5] = rtc_read(RTC_YEAR);
+}
+
+// Copies the wall-clock time from the RTC; caller holds the sequence count odd.
+// Returns -1 without touching the page if the RTC is mid-update or the time
+// changed between two reads, so the caller can try again later.
+static int rtc_sync(void) {
+    uint8_t a[6], b[6];
+
+    outb(RTC_INDEX_PORT, RTC_STATUS_A);
+    if (inb(RTC_DATA_PORT) & RTC_UIP) {
+        return -1;
+    }
+    rtc_read_all(a);
+    rtc_read_all(b);
+    for (int i = 0; i < 6; i++) {
+        if (a[i] != b[i]) {
+            return -1;
+        }
+    }
+    kernel_time_page.seconds = a[0];
+    kernel_time_page.minutes = a[1];
+    kernel_time_page.hours = a[2];
+    kernel_time_page.day = a[3];
+    kernel_time_page.month = a[4];
+    kernel_time_page.year = a[5];
+    return 0;
+}
+
+// Advances the tick count and recalibrates the TSC rate; resyncs with the RTC once a second
+static __attribute__((interrupt)) void timer_isr(void *int_frame) {
+    (void)int_frame;
+    uint64_t tsc = rdtsc();
+
+    kernel_time_page.seq++; // Odd: readers retry
+    __asm__ volatile ("" ::: "memory");
+
+    kernel_time_page.tsc_per_tick = (uint32_t)(tsc - kernel_time_page.tsc_at_tick);
+    kernel_time_page.tsc_at_tick = tsc;
+    kernel_time_page.ticks++;
+    if (++ticks_since_sync >= TIMER_HZ && rtc_sync() == 0) {
+        ticks_since_sync = 0; // Otherwise try again on the next tick
+    }
+
+    __asm__ volatile ("" ::: "memory");
+    kernel_time_page.seq++; // Even: page is consistent again
+
+    outb(PIC1, EOI);
+}
+
+void timer_init(void) {
+    uint16_t divisor = PIT_FREQ / TIMER_HZ;
+
+    kernel_time_page.seq++;
+    kernel_time_page.ticks = 0;
+    kernel_time_page.tsc_per_tick = 0;
+    kernel_time_page.tsc_at_tick = rdtsc();
+    while (rtc_sync() != 0) {
+        // Wait out the RTC update; it takes at most 2 ms
+    }
+    kernel_time_page.seq++;
+
+    outb(PIT_COMMAND, PIT_MODE);
+    outb(PIT_CHANNEL0, divisor & 0xFF);
+    outb(PIT_CHANNEL0, (divisor >> 8) & 0xFF);
+
+    idt_install(TIMER_VECTOR, timer_isr);
+
+    // Unmask IRQ 0
+    outb(PIC1 + 1, inb(PIC1 + 1) & ~0x01);
+}
@@ -0,0 +1,164 @@
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include <mpx/vm.h>
+#include <buddy.h>
+
+/*
+ * Order 0 is a BUDDY_MIN_SIZE block; order max_order is the whole pool.
+ * Free blocks sit on one list per order, linked through their own first
+ * bytes. free_map has one bit per block of every order, set while that
+ * block is on its free list, so a buddy is checked without touching its
+ * memory. alloc_order records the order of each allocated block at its
+ * first order-0 slot, which is all buddy_free() needs from a bare pointer.
+ */
+#define MIN_SHIFT	5
+#define MAX_ORDERS	24
+#define NO_BLOCK	0xFF
+
+#define block_size(o)	((size_t)BUDDY_MIN_SIZE << (o))
+
+struct buddy_link {
+	struct buddy_link *next;
+	struct buddy_link *prev;
+};
+
+static char *pool;
+static unsigned int max_order;
+static struct buddy_link *free_lists[MAX_ORDERS];
+static uint32_t list_map;		// bit o set when free_lists[o] is non-empty
+static uint32_t *free_map;
+static size_t map_base[MAX_ORDERS];	// first free_map bit of each order
+static uint8_t *alloc_order;
+
+static size_t map_bit(unsigned int order, size_t off)
+{
+	return map_base[order] + (off >> (MIN_SHIFT + order));
+}
+
+static int is_free(unsigned int order, size_t off)
+{
+	size_t bit = map_bit(order, off);
+	return (free_map[bit / 32] >> (bit % 32)) & 1;
+}
+
+static void list_push(unsigned int order, size_t off)
+{
+	struct buddy_link *block = (void *)(pool + off);
+	size_t bit = map_bit(order, off);
+
+	block->prev = NULL;
+	block->next = free_lists[order];
+	if (block->next) {
+		block->next->prev = block;
+	}
+	free_lists[order] = block;
+	list_map |= (uint32_t)1 << order;
+	free_map[bit / 32] |= (uint32_t)1 << (bit % 32);
+}
+
+static void list_remove(unsigned int order, size_t off)
+{
+	struct buddy_link *block = (void *)(pool + off);
+	size_t bit = map_bit(order, off);
+
+	if (block->next) {
+		block->next->prev = block->prev;
+	}
+	if (block->prev) {
+		block->prev->next = block->next;
+	} else {
+		free_lists[order] = block->next;
+		if (block->next == NULL) {
+			list_map &= ~((uint32_t)1 << order);
+		}
+	}
+	free_map[bit / 32] &= ~((uint32_t)1 << (bit % 32));
+}
+
+int buddy_init(size_t sz)
+{
+	max_order = 0;
+	while (max_order + 1 < MAX_ORDERS && block_size(max_order + 1) <= sz) {
+		max_order++;
+	}
+
+	size_t nbits = 0;
+	for (unsigned int o = 0; o <= max_order; o++) {
+		map_base[o] = nbits;
+		nbits += (size_t)1 << (max_order - o);
+	}
+	size_t map_bytes = (nbits + 31) / 32 * sizeof(uint32_t);
+	size_t slots = (size_t)1 << max_order;
+
+	free_map = kmalloc(map_bytes, 0, NULL);
+	alloc_order = kmalloc(slots, 0, NULL);
+	pool = kmalloc(block_size(max_order), 1, NULL);
+	if (free_map == NULL || alloc_order == NULL || pool == NULL) {
+		pool = NULL;
+		return -1;
+	}
+	memset(free_map, 0, map_bytes);
+	memset(alloc_order, NO_BLOCK, slots);
+	memset(free_lists, 0, sizeof(free_lists));
+	list_map = 0;
+
+	list_push(max_order, 0);
+	return 0;
+}
+
+void *buddy_alloc(size_t sz)
+{
+	unsigned int order = 0;
+	while (order <= max_order && block_size(order) < sz) {
+		order++;
+	}
+
+	uint32_t candidates = list_map & (~(uint32_t)0 << order);
+	if (order > max_order || candidates == 0) {
+		return NULL;
+	}
+
+	unsigned int o = __builtin_ctz(candidates);
+	size_t off = (size_t)((char *)free_lists[o] - pool);
+	list_remove(o, off);
+
+	// hand the upper halves back until the block is the right size
+	while (o > order) {
+		o--;
+		list_push(o, off + block_size(o));
+	}
+
+	alloc_order[off >> MIN_SHIFT] = (uint8_t)order;
+	return pool + off;
+}
+
+int buddy_free(void *ptr)
+{
+	char *p = ptr;
+
+	if (pool == NULL || p < pool || p >= pool + block_size(max_order)) {
+		return -1;
+	}
+
+	size_t off = (size_t)(p - pool);
+	if (off & (BUDDY_MIN_SIZE - 1) || alloc_order[off >> MIN_SHIFT] == NO_BLOCK) {
+		return -1;
+	}
+
+	unsigned int order = alloc_order[off >> MIN_SHIFT];
+	alloc_order[off >> MIN_SHIFT] = NO_BLOCK;
+
+	while (order < max_order) {
+		size_t buddy = off ^ block_size(order);
+		if (!is_free(order, buddy)) {
+			break;
+		}
+		list_remove(order, buddy);
+		off &= ~block_size(order);
+		order++;
+	}
+
+	list_push(order, off);
+	return 0;
+}
@@ -1,65 +1,603 @@
 #include <stddef.h>
+#include <stdint.h>
+#include <string.h>
 #include <mpx/vm.h>
 #include <memory.h>
 
-#define roundup(s) ((s) & (END|FREE) ? ((s) & ~(END|FREE)) + 4 : (s))
+/*
+ * Blocks are sized in multiples of MCB_ALIGN, so the low bits of the size
+ * field are free for flags. A free block keeps its free-list links in its
+ * own payload, which is why no block is smaller than MCB_MIN.
+ *
+ * By default free blocks are kept in segregated lists: one exact-size bin
+ * per MCB_ALIGN step below SMALL_LIMIT, and a single list ordered by size
+ * for everything larger. Building with MEM_FIRST_FIT restores the original
+ * first-fit walk over every block in memlist.
+ *
+ * Every block ends with a footer holding a copy of its size field, so the
+ * block before a header can be found without walking memlist:
+ *
+ *	| size | payload ... | size | size | payload ... | size |
+ *
+ * The heap is placed so that every payload starts on an MCB_ALIGN boundary
+ * in memory, not just relative to memlist; allocate_aligned_memory() relies
+ * on that to carve larger alignments out of ordinary blocks.
+ *
+ * A free block marked CLEAN has a payload of zeroes apart from its
+ * free-list links, so allocate_zeroed_memory() only has to clear those.
+ */
+#define MCB_ALIGN	8
+#define MCB_MIN		(2 * sizeof(void *))
+#define SMALL_LIMIT	256
+#define NBINS		(SMALL_LIMIT / MCB_ALIGN)
+
+#define roundup(s)	(((s) + MCB_ALIGN - 1) & ~(size_t)(MCB_ALIGN - 1))
+
+struct mcb_links {
+	struct mcb *next;
+	struct mcb *prev;
+};
+
+#define mcb_links(m)	((struct mcb_links *)(m)->start)
+#define mcb_footer(m)	((size_t *)((m)->start + mcb_size(m)))
+#define MCB_OVERHEAD	(sizeof(struct mcb) + sizeof(size_t))
 
 struct mcb *memlist = NULL;
+static char *heap_end;			// first byte past the last footer
 
-void initialize_heap(size_t sz)
+static size_t in_use;			// payload bytes of allocated blocks
+static size_t peak;			// highest in_use so far
+static size_t nallocs;
+static size_t nfrees;
+
+#ifndef MEM_FIRST_FIT
+static struct mcb *bins[NBINS];		// exact-size lists of small free blocks
+static uint32_t bin_map;		// bit i set when bins[i] is non-empty
+static struct mcb *large;		// free blocks >= SMALL_LIMIT, smallest first
+#endif
+
+static void freelist_insert(struct mcb *mcb)
 {
-	sz = roundup(sz);
-	memlist = kmalloc(sz + sizeof(*memlist), 0, NULL);
-	memlist->size = sz | FREE | END;
+#ifdef MEM_FIRST_FIT
+	(void)mcb;
+#else
+	size_t sz = mcb_size(mcb);
+	struct mcb **head;
+	struct mcb *prev = NULL;
+
+	if (sz < SMALL_LIMIT) {
+		head = &bins[sz / MCB_ALIGN];
+		bin_map |= (uint32_t)1 << (sz / MCB_ALIGN);
+	} else {
+		head = &large;
+		while (*head && mcb_size(*head) < sz) {
+			prev = *head;
+			head = &mcb_links(*head)->next;
+		}
+	}
+
+	mcb_links(mcb)->prev = prev;
+	mcb_links(mcb)->next = *head;
+	if (*head) {
+		mcb_links(*head)->prev = mcb;
+	}
+	*head = mcb;
+#endif
 }
 
-void *allocate_memory(size_t sz)
+static void freelist_remove(struct mcb *mcb)
 {
-	sz = roundup(sz);
+#ifdef MEM_FIRST_FIT
+	(void)mcb;
+#else
+	size_t sz = mcb_size(mcb);
+	struct mcb_links *links = mcb_links(mcb);
+
+	if (links->next) {
+		mcb_links(links->next)->prev = links->prev;
+	}
+	if (links->prev) {
+		mcb_links(links->prev)->next = links->next;
+	} else if (sz < SMALL_LIMIT) {
+		bins[sz / MCB_ALIGN] = links->next;
+		if (links->next == NULL) {
+			bin_map &= ~((uint32_t)1 << (sz / MCB_ALIGN));
+		}
+	} else {
+		large = links->next;
+	}
+#endif
+}
+
+static struct mcb *find_fit(size_t sz)
+{
+#ifdef MEM_FIRST_FIT
 	for (struct mcb *mcb = memlist; mcb != NULL; mcb = mcb_next(mcb)) {
 		if (mcb_size(mcb) >= sz && mcb_isfree(mcb)) {
-			if (mcb_size(mcb) > sz + sizeof(*mcb)) {
-				struct mcb *newfree = (void*)(mcb->start + sz);
-				newfree->size = mcb_size(mcb) - sz - sizeof(*mcb);
-				mcb_setfree(newfree);
-				mcb_copyend(newfree, mcb);
-				mcb->size = sz;
-			}
-			mcb_clrfree(mcb);
-			return mcb->start;
+			return mcb;
 		}
 	}
+#else
+	if (sz < SMALL_LIMIT) {
+		uint32_t candidates = bin_map & (~(uint32_t)0 << (sz / MCB_ALIGN));
+		if (candidates) {
+			return bins[__builtin_ctz(candidates)];
+		}
+	}
+	for (struct mcb *mcb = large; mcb != NULL; mcb = mcb_links(mcb)->next) {
+		if (mcb_size(mcb) >= sz) {
+			return mcb;
+		}
+	}
+#endif
 	return NULL;
 }
 
-int free_memory(void *ptr)
+static void mcb_settag(struct mcb *mcb)
+{
+	*mcb_footer(mcb) = mcb->size;
+}
+
+static struct mcb *mcb_prev(struct mcb *mcb)
+{
+	if (mcb == memlist) {
+		return NULL;
+	}
+	size_t tag = ((size_t *)mcb)[-1];
+	return (void*)((char *)mcb - (tag & ~(size_t)MCB_FLAGS) - MCB_OVERHEAD);
+}
+
+/*
+ * Maps a pointer handed to free_memory() back to its block, or NULL if it
+ * cannot be the start of an allocated block.
+ */
+static struct mcb *mcb_from_ptr(void *ptr)
+{
+	char *p = ptr;
+
+	if (memlist == NULL || p < memlist->start || p >= heap_end) {
+		return NULL;
+	}
+	if ((size_t)(p - memlist->start) % MCB_ALIGN != 0) {
+		return NULL;
+	}
+
+	struct mcb *mcb = (void*)(p - sizeof(struct mcb));
+	if (mcb_isfree(mcb) || mcb_size(mcb) < MCB_MIN ||
+	    (size_t)(heap_end - p) < mcb_size(mcb) + sizeof(size_t) ||
+	    *mcb_footer(mcb) != mcb->size) {
+		return NULL;
+	}
+	return mcb;
+}
+
+/*
+ * Cuts mcb down to sz bytes if the rest can form a block of its own, and
+ * returns the rest as a free block that is not on a free list yet. The
+ * rest is clean only if mcb was.
+ */
+static struct mcb *mcb_split(struct mcb *mcb, size_t sz)
+{
+	if (mcb_size(mcb) < sz + MCB_OVERHEAD + MCB_MIN) {
+		return NULL;
+	}
+	struct mcb *rest = (void*)(mcb->start + sz + sizeof(size_t));
+	rest->size = (mcb_size(mcb) - sz - MCB_OVERHEAD) | FREE | (mcb->size & (END|CLEAN));
+	mcb_settag(rest);
+	mcb->size = sz | (mcb->size & (FREE|CLEAN));
+	mcb_settag(mcb);
+	return rest;
+}
+
+/*
+ * Absorbs next, the free block directly after mcb, into mcb. The result
+ * stays clean only if both were, in which case the header, links and
+ * footer that end up inside the payload are cleared.
+ */
+static void mcb_merge(struct mcb *mcb, struct mcb *next)
+{
+	size_t old = mcb_size(mcb);
+	int clean = mcb_isclean(mcb) && mcb_isclean(next);
+
+	mcb->size += mcb_size(next) + MCB_OVERHEAD;
+	mcb_copyend(mcb, next);
+	if (clean) {
+		memset(mcb->start + old, 0, MCB_OVERHEAD + sizeof(struct mcb_links));
+	} else {
+		mcb_clrclean(mcb);
+	}
+}
+
+/* Coalesces a block already marked free with its neighbours and lists it */
+static void mcb_release(struct mcb *mcb)
 {
-	struct mcb *prev = NULL;
-	struct mcb *mcb = memlist;
 	struct mcb *next = mcb_next(mcb);
+	struct mcb *prev = mcb_prev(mcb);
 
-	while (mcb != NULL) {
-		if (mcb->start == ptr && !mcb_isfree(mcb)) {
-			mcb_setfree(mcb);
-			if (next && mcb_isfree(next)) {
-				mcb->size += mcb_size(next) + sizeof(*mcb);
-				mcb_copyend(mcb, next);
-			}
-			if (prev && mcb_isfree(prev)) {
-				prev->size += mcb_size(mcb) + sizeof(*mcb);
-				mcb_copyend(prev, mcb);
-			}
-			return 0;
+	if (next && mcb_isfree(next)) {
+		freelist_remove(next);
+		mcb_merge(mcb, next);
+	}
+	if (prev && mcb_isfree(prev)) {
+		freelist_remove(prev);
+		mcb_merge(prev, mcb);
+		mcb = prev;
+	}
+	mcb_settag(mcb);
+	freelist_insert(mcb);
+}
+
+/* Takes a block of at least sz bytes off the free lists, still flagged CLEAN if it was */
+static struct mcb *take_block(size_t sz)
+{
+	sz = sz < MCB_MIN ? MCB_MIN : roundup(sz);
+
+	struct mcb *mcb = find_fit(sz);
+	if (mcb == NULL) {
+		return NULL;
+	}
+
+	freelist_remove(mcb);
+	struct mcb *rest = mcb_split(mcb, sz);
+	if (rest) {
+		freelist_insert(rest);
+	}
+	mcb_clrfree(mcb);
+	mcb_settag(mcb);
+	return mcb;
+}
+
+/*
+ * Allocation profiler. While it is on, every block handed out is recorded
+ * in a side table along with the call site and owner that asked for it,
+ * and each site keeps running totals. Both tables are fixed in size;
+ * allocations that do not fit are only counted in prof_dropped.
+ */
+#define PROF_SITES	128
+#define PROF_BLOCKS	4096		// a power of two
+
+struct prof_block {
+	struct mcb *mcb;		// NULL for an empty slot
+	size_t size;
+	uint16_t site;
+};
+
+static int profiling;
+static void *prof_caller;		// overrides the caller of the next allocation
+static int (*prof_owner)(void);
+static struct heap_site prof_sites[PROF_SITES];
+static int prof_nsites;
+static struct prof_block prof_blocks[PROF_BLOCKS];
+static size_t prof_nblocks;
+static size_t prof_dropped;
+
+static size_t prof_slot(struct mcb *mcb)
+{
+	return (((uintptr_t)mcb >> 3) * 2654435761u) & (PROF_BLOCKS - 1);
+}
+
+static struct prof_block *prof_find(struct mcb *mcb)
+{
+	for (size_t i = prof_slot(mcb); prof_blocks[i].mcb; i = (i + 1) & (PROF_BLOCKS - 1)) {
+		if (prof_blocks[i].mcb == mcb) {
+			return &prof_blocks[i];
+		}
+	}
+	return NULL;
+}
+
+static void prof_add(struct mcb *mcb, void *caller)
+{
+	int owner = prof_owner ? prof_owner() : 0;
+	struct heap_site *site = NULL;
+
+	for (int i = 0; i < prof_nsites; i++) {
+		if (prof_sites[i].caller == caller && prof_sites[i].owner == owner) {
+			site = &prof_sites[i];
+			break;
 		}
+	}
+	if (site == NULL && prof_nsites < PROF_SITES) {
+		site = &prof_sites[prof_nsites++];
+		site->caller = caller;
+		site->owner = owner;
+	}
+	// one slot always stays empty so lookups terminate
+	if (site == NULL || prof_nblocks == PROF_BLOCKS - 1) {
+		prof_dropped++;
+		return;
+	}
 
-		prev = mcb;
-		mcb = next;
-		next = mcb_next(mcb);
+	size_t i = prof_slot(mcb);
+	while (prof_blocks[i].mcb) {
+		i = (i + 1) & (PROF_BLOCKS - 1);
+	}
+	prof_blocks[i].mcb = mcb;
+	prof_blocks[i].size = mcb_size(mcb);
+	prof_blocks[i].site = (uint16_t)(site - prof_sites);
+	prof_nblocks++;
+
+	site->allocs++;
+	site->live_blocks++;
+	site->live_bytes += mcb_size(mcb);
+}
+
+static void prof_remove(struct mcb *mcb)
+{
+	struct prof_block *b = prof_find(mcb);
+	if (b == NULL) {
+		return;
+	}
+	prof_sites[b->site].live_blocks--;
+	prof_sites[b->site].live_bytes -= b->size;
+
+	// backward-shift deletion keeps every probe run unbroken
+	size_t i = b - prof_blocks;
+	for (size_t j = (i + 1) & (PROF_BLOCKS - 1); prof_blocks[j].mcb; j = (j + 1) & (PROF_BLOCKS - 1)) {
+		size_t k = prof_slot(prof_blocks[j].mcb);
+		if (i <= j ? (k <= i || k > j) : (k <= i && k > j)) {
+			prof_blocks[i] = prof_blocks[j];
+			i = j;
+		}
+	}
+	prof_blocks[i].mcb = NULL;
+	prof_nblocks--;
+}
+
+static void prof_resize(struct mcb *mcb)
+{
+	struct prof_block *b = prof_find(mcb);
+	if (b != NULL) {
+		prof_sites[b->site].live_bytes += mcb_size(mcb) - b->size;
+		b->size = mcb_size(mcb);
+	}
+}
+
+void heap_profile_enable(int on)
+{
+	if (on && !profiling) {
+		memset(prof_sites, 0, sizeof(prof_sites));
+		memset(prof_blocks, 0, sizeof(prof_blocks));
+		prof_nsites = 0;
+		prof_nblocks = 0;
+		prof_dropped = 0;
+	}
+	profiling = on;
+}
+
+void heap_profile_caller(void *caller)
+{
+	prof_caller = caller;
+}
+
+void heap_profile_owner(int (*owner)(void))
+{
+	prof_owner = owner;
+}
+
+const struct heap_site *heap_profile_sites(int *count, size_t *dropped)
+{
+	*count = prof_nsites;
+	*dropped = prof_dropped;
+	return prof_sites;
+}
+
+/* Counts a block that is about to be handed out */
+static void *mcb_charge(struct mcb *mcb, void *caller)
+{
+	if (profiling) {
+		prof_add(mcb, prof_caller ? prof_caller : caller);
+	}
+	prof_caller = NULL;
+	nallocs++;
+	in_use += mcb_size(mcb);
+	if (in_use > peak) {
+		peak = in_use;
+	}
+	return mcb->start;
+}
+
+int initialize_heap(size_t sz)
+{
+	sz = roundup(sz);
+	char *base = kmalloc(sz + MCB_OVERHEAD + MCB_ALIGN, 0, NULL);
+	if (base == NULL) {
+		return -1;
+	}
+	memlist = (void*)(roundup((uintptr_t)base + sizeof(struct mcb)) - sizeof(struct mcb));
+#ifndef MEM_FIRST_FIT
+	memset(bins, 0, sizeof(bins));
+	bin_map = 0;
+	large = NULL;
+#endif
+	in_use = peak = nallocs = nfrees = 0;
+	profiling = 0;
+	prof_nblocks = 0;
+	memset(prof_blocks, 0, sizeof(prof_blocks));
+	// not CLEAN: allocate_zeroed_memory() clears it lazily
+	memlist->size = sz | FREE | END;
+	mcb_settag(memlist);
+	heap_end = (char *)memlist + sz + MCB_OVERHEAD;
+	freelist_insert(memlist);
+	return 0;
+}
+
+void *allocate_memory(size_t sz)
+{
+	struct mcb *mcb = take_block(sz);
+	if (mcb == NULL) {
+		prof_caller = NULL;	// meant for this allocation only
+		return NULL;
+	}
+	mcb_clrclean(mcb);
+	mcb_settag(mcb);
+	return mcb_charge(mcb, __builtin_return_address(0));
+}
+
+void *allocate_zeroed_memory(size_t nmemb, size_t sz)
+{
+	if (sz != 0 && nmemb > (size_t)-1 / sz) {
+		return NULL;
+	}
+
+	struct mcb *mcb = take_block(nmemb * sz);
+	if (mcb == NULL) {
+		return NULL;
+	}
+	if (mcb_isclean(mcb)) {
+		memset(mcb->start, 0, sizeof(struct mcb_links));
+	} else {
+		memset(mcb->start, 0, nmemb * sz);
+	}
+	mcb_clrclean(mcb);
+	mcb_settag(mcb);
+	return mcb_charge(mcb, __builtin_return_address(0));
+}
+
+void *allocate_aligned_memory(size_t align, size_t sz)
+{
+	if (align == 0 || (align & (align - 1)) != 0) {
+		return NULL;
+	}
+	if (align <= MCB_ALIGN) {
+		if (prof_caller == NULL) {
+			prof_caller = __builtin_return_address(0);
+		}
+		return allocate_memory(sz);
+	}
+
+	size_t want = sz < MCB_MIN ? MCB_MIN : roundup(sz);
+	if (want > (size_t)-1 - align - MCB_OVERHEAD - MCB_MIN) {
+		return NULL;
+	}
+
+	// enough for the request wherever the boundary falls, with room for
+	// the slack in front of it to become a free block of its own
+	struct mcb *mcb = take_block(want + align + MCB_OVERHEAD + MCB_MIN);
+	if (mcb == NULL) {
+		return NULL;
+	}
+
+	uintptr_t start = (uintptr_t)mcb->start;
+	if (start & (align - 1)) {
+		uintptr_t p = (start + MCB_OVERHEAD + MCB_MIN + align - 1) & ~(uintptr_t)(align - 1);
+		struct mcb *lead = mcb;
+
+		mcb = (void*)(p - sizeof(struct mcb));
+		mcb->size = (start + mcb_size(lead) - p) | (lead->size & (END|CLEAN));
+		mcb_settag(mcb);
+		lead->size = (p - MCB_OVERHEAD - start) | FREE | (lead->size & CLEAN);
+		mcb_settag(lead);
+		mcb_release(lead);
+	}
+
+	struct mcb *rest = mcb_split(mcb, want);
+	if (rest) {
+		mcb_release(rest);
+	}
+	mcb_clrclean(mcb);
+	mcb_settag(mcb);
+	return mcb_charge(mcb, __builtin_return_address(0));
+}
+
+void *reallocate_memory(void *ptr, size_t sz)
+{
+	if (ptr == NULL) {
+		return allocate_memory(sz);
+	}
+
+	struct mcb *mcb = mcb_from_ptr(ptr);
+	if (mcb == NULL) {
+		return NULL;
+	}
+	if (sz == 0) {
+		free_memory(ptr);
+		return NULL;
+	}
+
+	size_t want = sz < MCB_MIN ? MCB_MIN : roundup(sz);
+	size_t old = mcb_size(mcb);
+
+	// grow in place when the next block is free and large enough
+	struct mcb *next = mcb_next(mcb);
+	if (want > mcb_size(mcb) && next && mcb_isfree(next) &&
+	    mcb_size(mcb) + MCB_OVERHEAD + mcb_size(next) >= want) {
+		freelist_remove(next);
+		mcb_merge(mcb, next);
+		mcb_settag(mcb);
+	}
+
+	if (want <= mcb_size(mcb)) {
+		struct mcb *rest = mcb_split(mcb, want);
+		if (rest) {
+			mcb_release(rest);
+		}
+		if (prof_nblocks) {
+			prof_resize(mcb);
+		}
+		in_use = in_use - old + mcb_size(mcb);
+		if (in_use > peak) {
+			peak = in_use;
+		}
+		return ptr;
+	}
+
+	if (prof_caller == NULL) {
+		prof_caller = __builtin_return_address(0);
+	}
+	void *moved = allocate_memory(sz);
+	if (moved == NULL) {
+		return NULL;
+	}
+	memcpy(moved, ptr, mcb_size(mcb));
+	free_memory(ptr);
+	return moved;
+}
+
+int free_memory(void *ptr)
+{
+	struct mcb *mcb = mcb_from_ptr(ptr);
+	if (mcb == NULL) {
+		return -1;
+	}
+
+	if (prof_nblocks) {
+		prof_remove(mcb);	// also after the profiler is turned off
+	}
+	nfrees++;
+	in_use -= mcb_size(mcb);
+	mcb_setfree(mcb);
+	mcb_release(mcb);
+	return 0;
+}
+
+int heap_get_stats(struct heap_stats *stats)
+{
+	if (memlist == NULL) {
+		return -1;
+	}
+
+	memset(stats, 0, sizeof(*stats));
+	for (struct mcb *mcb = memlist; mcb != NULL; mcb = mcb_next(mcb)) {
+		size_t sz = mcb_size(mcb);
+		stats->total += sz;
+		if (mcb_isfree(mcb)) {
+			stats->free += sz;
+			stats->free_blocks++;
+			if (sz > stats->largest_free) {
+				stats->largest_free = sz;
+			}
+		} else {
+			stats->allocated += sz;
+		}
 	}
-	return -1;
+	stats->allocs = nallocs;
+	stats->frees = nfrees;
+	stats->peak = peak;
+	return 0;
 }
 
 struct mcb *mcb_next(struct mcb *mcb)
 {
-	return mcb_isend(mcb) ? NULL : (void*)(mcb->start + mcb_size(mcb));
+	return mcb_isend(mcb) ? NULL : (void*)(mcb->start + mcb_size(mcb) + sizeof(size_t));
 }
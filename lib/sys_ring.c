@@ -0,0 +1,60 @@
+#include <sys_ring.h>
+
+#define RING_MASK (SYS_RING_SIZE - 1)
+
+void sys_ring_init(struct sys_ring *ring)
+{
+	ring->sq_head = ring->sq_tail = 0;
+	ring->cq_head = ring->cq_tail = 0;
+}
+
+int sys_ring_queue(struct sys_ring *ring, op_code op, uintptr_t a,
+		   uintptr_t b, uintptr_t c, uint32_t user_data)
+{
+	// every submission needs a completion slot once it runs
+	if (ring->sq_tail - ring->cq_head >= SYS_RING_SIZE) {
+		return -1;
+	}
+
+	struct sys_sqe *sqe = &ring->sq[ring->sq_tail & RING_MASK];
+	sqe->op = op;
+	sqe->a = a;
+	sqe->b = b;
+	sqe->c = c;
+	sqe->user_data = user_data;
+	ring->sq_tail++;
+	return 0;
+}
+
+int sys_ring_write(struct sys_ring *ring, device dev, const char *buf, size_t len)
+{
+	return sys_ring_queue(ring, WRITE, dev, (uintptr_t)buf, len, 0);
+}
+
+int sys_ring_read(struct sys_ring *ring, device dev, char *buf, size_t len)
+{
+	return sys_ring_queue(ring, READ, dev, (uintptr_t)buf, len, 0);
+}
+
+int sys_ring_sleep(struct sys_ring *ring, unsigned int ticks)
+{
+	return sys_ring_queue(ring, SLEEP, ticks, 0, 0, 0);
+}
+
+int sys_ring_submit(struct sys_ring *ring)
+{
+	if (ring->sq_head == ring->sq_tail) {
+		return 0;
+	}
+	return sys_req3(SUBMIT, (uintptr_t)ring, 0, 0);
+}
+
+int sys_ring_reap(struct sys_ring *ring, struct sys_cqe *cqe)
+{
+	if (ring->cq_head == ring->cq_tail) {
+		return 0;
+	}
+	*cqe = ring->cq[ring->cq_head & RING_MASK];
+	ring->cq_head++;
+	return 1;
+}
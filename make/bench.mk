@@ -0,0 +1,34 @@
+.POSIX:
+
+# Host-native heap benchmark: "make bench" builds lib/mem.c (segregated
+# fit and MEM_FIRST_FIT) and lib/buddy.c with the host compiler and runs
+# the same seeded workloads against each.
+
+HOSTCC = cc
+BENCH_CFLAGS = -std=c11 -O2 -Wall -Wextra -g
+
+bench/mem.o: lib/mem.c include/memory.h include/mpx/vm.h
+	$(HOSTCC) $(BENCH_CFLAGS) -Iinclude -c -o $@ lib/mem.c
+
+bench/mem-firstfit.o: lib/mem.c include/memory.h include/mpx/vm.h
+	$(HOSTCC) $(BENCH_CFLAGS) -Iinclude -DMEM_FIRST_FIT -c -o $@ lib/mem.c
+
+bench/buddy.o: lib/buddy.c include/buddy.h include/mpx/vm.h
+	$(HOSTCC) $(BENCH_CFLAGS) -Iinclude -c -o $@ lib/buddy.c
+
+bench/bench.o: bench/bench.c include/memory.h include/buddy.h include/pcb.h
+	$(HOSTCC) $(BENCH_CFLAGS) -c -o $@ bench/bench.c
+
+bench/bench: bench/bench.o bench/mem.o bench/buddy.o
+	$(HOSTCC) -o $@ bench/bench.o bench/mem.o bench/buddy.o
+
+bench/bench-firstfit: bench/bench.o bench/mem-firstfit.o bench/buddy.o
+	$(HOSTCC) -o $@ bench/bench.o bench/mem-firstfit.o bench/buddy.o
+
+bench: bench/bench bench/bench-firstfit
+	./bench/bench mcb segregated-fit
+	./bench/bench-firstfit mcb first-fit
+	./bench/bench buddy buddy
+
+bench-clean:
+	rm -f bench/*.o bench/bench bench/bench-firstfit
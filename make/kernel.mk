@@ -5,20 +5,51 @@ kernel/serial.o: kernel/serial.c include/mpx/io.h include/mpx/serial.h \
 
 kernel/kmain.o: kernel/kmain.c include/mpx/gdt.h include/mpx/interrupts.h \
   include/mpx/serial.h include/mpx/device.h include/mpx/vm.h \
-  include/sys_req.h include/string.h include/memory.h
+  include/mpx/timer.h include/sys_req.h include/sys_call.h include/string.h \
+  include/memory.h include/buddy.h include/mpx/multiboot.h \
+  include/time_page.h include/mpx/arena.h include/mpx/panic.h \
+  include/mpx/idle.h
 
 kernel/core-c.o: kernel/core-c.c include/mpx/gdt.h include/mpx/panic.h \
   include/mpx/interrupts.h include/mpx/io.h include/mpx/serial.h \
   include/mpx/device.h include/sys_req.h include/string.h \
-  include/mpx/vm.h
+  include/mpx/vm.h include/mpx/multiboot.h include/mpx/stack.h
 
-kernel/R3_Context/syscall.o: kernel/R3_Context/syscall.c include/context.h include/pcb.h
+kernel/R3_Context/syscall.o: kernel/R3_Context/syscall.c include/context.h include/pcb.h \
+  include/sys_call.h include/sys_req.h include/sys_ring.h include/time_page.h \
+  include/mpx/kthread.h include/mpx/stack.h include/mpx/serial.h
 
-kernel/serial_io.o: kernel/serial_io.c include/serial_io.h include/mpx/io.h include/mpx/interrupts.h include/mpx/device.h
+kernel/timer.o: kernel/timer.c include/mpx/timer.h include/mpx/interrupts.h \
+  include/mpx/io.h include/time_page.h
+
+kernel/serial_io.o: kernel/serial_io.c include/serial_io.h include/mpx/io.h include/mpx/interrupts.h include/mpx/device.h include/mpx/slab.h
 
 kernel/sys_call_isr.o: kernel/sys_call_isr.s
 	nasm -f elf -o kernel/sys_call_isr.o kernel/sys_call_isr.s
 
+kernel/stack.o: kernel/stack.c include/mpx/stack.h include/mpx/vm.h \
+  include/mpx/panic.h include/mpx/serial.h include/string.h
+
+kernel/page_fault_task.o: kernel/page_fault_task.s
+	nasm -f elf -o kernel/page_fault_task.o kernel/page_fault_task.s
+
+kernel/slab.o: kernel/slab.c include/mpx/slab.h include/mpx/vm.h include/memory.h \
+  include/string.h
+
+kernel/arena.o: kernel/arena.c include/mpx/arena.h include/memory.h \
+  include/pcb.h include/sys_call.h include/string.h
+
+kernel/ksyms.o: kernel/ksyms.c include/mpx/ksyms.h
+
+kernel/idle.o: kernel/idle.c include/mpx/idle.h include/mpx/serial.h \
+  include/mpx/device.h include/mpx/vm.h include/sys_req.h include/string.h
+
+kernel/kthread.o: kernel/kthread.c include/mpx/kthread.h include/memory.h \
+  include/string.h
+
+kernel/kthread_switch.o: kernel/kthread_switch.s
+	nasm -f elf -o kernel/kthread_switch.o kernel/kthread_switch.s
+
 kernel/serial_isr_asm.o: kernel/serial_isr_asm.s
 	nasm -f elf -o kernel/serial_isr_asm.o kernel/serial_isr_asm.s
 
@@ -31,4 +62,13 @@ KERNEL_OBJECTS = \
   kernel/pcb.o \
   kernel/R3_Context/syscall.o \
   kernel/serial_io.o \
+  kernel/timer.o \
+  kernel/kthread.o \
+  kernel/slab.o \
+  kernel/arena.o \
+  kernel/ksyms.o \
+  kernel/idle.o \
+  kernel/stack.o \
+  kernel/page_fault_task.o \
+  kernel/kthread_switch.o \
   kernel/serial_isr_asm.o
@@ -0,0 +1,15 @@
+#!/bin/sh
+#
+# Writes kernel/ksyms_table.c to stdout: the text symbols of the kernel
+# image given as $1, sorted by address. Without an image the table is
+# empty, which is what the first of the two kernel links uses.
+
+NM=${NM:-nm}
+
+printf '#include <mpx/ksyms.h>\n\n'
+printf 'const struct ksym ksyms[] = {\n'
+if [ -n "$1" ]; then
+	$NM -n "$1" | awk '$2 ~ /^[tT]$/ { printf "\t{ 0x%s, \"%s\" },\n", $1, $3 }'
+fi
+printf '\t{ 0, 0 }\n};\n\n'
+printf 'const unsigned int nksyms = sizeof(ksyms) / sizeof(ksyms[0]) - 1;\n'
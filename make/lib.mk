@@ -9,8 +9,18 @@ lib/core.o: lib/core.c include/mpx/serial.h include/mpx/device.h \
 
 lib/ctype.o: lib/ctype.c include/ctype.h
 
+lib/sys_ring.o: lib/sys_ring.c include/sys_ring.h include/sys_req.h \
+  include/mpx/device.h
+
+lib/mem.o: lib/mem.c include/memory.h include/mpx/vm.h
+
+lib/buddy.o: lib/buddy.c include/buddy.h include/mpx/vm.h include/string.h
+
 LIB_OBJECTS=\
 	lib/string.o\
 	lib/stdlib.o\
 	lib/core.o\
-	lib/ctype.o
+	lib/ctype.o\
+	lib/sys_ring.o\
+	lib/mem.o\
+	lib/buddy.o
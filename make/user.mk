@@ -6,6 +6,12 @@ user/core.o: user/core.c include/string.h include/mpx/serial.h \
 user/load_r3.o: user/load_r3.c include/load_r3.h include/processes.h \
   include/mpx/serial.h include/sys_req.h
 
+user/memuser.o: user/memuser.c include/memuser.h include/mpx/slab.h \
+  include/string.h include/stdlib.h include/sys_req.h
+
+user/mem.o: user/mem.c include/memory.h include/memuser.h include/string.h \
+  include/stdlib.h include/sys_req.h include/time_page.h include/mpx/ksyms.h
+
 USER_OBJECTS=\
 	user/core.o \
 	user/cmdHandler.o \
@@ -13,6 +19,8 @@ USER_OBJECTS=\
 	user/version.o \
 	user/time.o \
 	user/pcbuser.o \
+	user/memuser.o \
+	user/mem.o \
 	user/load_r3.o \
 	user/alarm.o \
 	user/yield.o
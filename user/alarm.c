@@ -7,6 +7,7 @@
 #include <sys_req.h>
 #include <string.h>
 #include <time.h>
+#include <time_page.h>
 #include <stdlib.h>
 
 #define RTC_INDEX_PORT 0x70
@@ -20,11 +21,13 @@ void alarm(struct time trigger, char* msg) {
 
 	for(;;) {
 		int current_s, current_m, current_h;
-	
-			// Read seconds, minutes, and hours from RTC registers
-		current_s = bcdToDecimal(readRTC(RTC_SECONDS_REG));
-		current_m = bcdToDecimal(readRTC(RTC_MINUTES_REG));
-		current_h = bcdToDecimal(readRTC(RTC_HOURS_REG));
+		struct time_page now;
+
+		// Read seconds, minutes, and hours from the kernel time page
+		time_page_read(&now);
+		current_s = now.seconds;
+		current_m = now.minutes;
+		current_h = now.hours;
 	
 		// If the alarm is past the right time to alert the user
 		if((current_h > trigger.hours) || (current_h == trigger.hours && current_m > trigger.minutes) || (current_h == trigger.hours && current_m == trigger.minutes && current_s > trigger.seconds)) {
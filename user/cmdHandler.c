@@ -6,6 +6,7 @@
 #include "time.h"
 #include "pcb.h"
 #include "pcbuser.h"
+#include "memuser.h"
 #include <alarm.h>
 #include <yield.h>
 #include "load_r3.h"
@@ -91,6 +92,7 @@ static command_map_t main_commands[] = {
         {"Help", help, "Displaying available commands...\n", -1},
         {"Time/Date Functions", NULL, "Navigating to Time/Date Functions...\n", 1},
         {"PCB Functions", NULL, "Navigating to PCB Functions...\n", 2},
+        {"Memory Functions", NULL, "Navigating to Memory Functions...\n", 3},
         {"Version", version, "Displaying Version...\n", -1},
 //        {"Yield",yield, "Yielding current process...\n", -1},
         {"Alarm", get_alarm, "Setting Alarm...\n", -1},
@@ -119,6 +121,14 @@ static command_map_t pcb_commands[] = {
         {"Show Ready", show_ready, "Displaying processes in READY state...\n", -1},
         {"Show Blocked", show_blocked, "Displaying processes in BLOCKED state...\n", -1},
         {"Show All", show_all, "Displaying all processes...\n", -1},
+        {"Stack Usage", stack_usage_all, "Measuring process stacks...\n", -1},
+        {"Return to Main Menu", NULL, "Returning...\n", 0},
+        {NULL, NULL, NULL, -1}
+};
+
+static command_map_t memory_commands[] = {
+        {"Slab Info", slab_info, "Displaying object caches...\n", -1},
+        {"Heap", heap_command, "Inspecting the heap...\n", -1},
         {"Return to Main Menu", NULL, "Returning...\n", 0},
         {NULL, NULL, NULL, -1}
 };
@@ -126,7 +136,8 @@ static command_map_t pcb_commands[] = {
 static menu_t menus[] = {
         {"\033[0;34mMain Menu\033[0;37m", main_commands},
         {"Time/Date Menu", time_date_commands},
-        {"PCB Menu", pcb_commands}
+        {"PCB Menu", pcb_commands},
+        {"Memory Menu", memory_commands}
 };
 
 static int current_menu = 0;
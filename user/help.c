@@ -19,16 +19,19 @@ const CommandHelp commands[] = {
         {"SetDate", "Sets the date on the operating system", "Three user inputs of 'mm', 'dd', 'yy'"},
         {"GetDate", "Gets the current date saved on the operating system", NULL},
         {"LoadR3", "Loads in processes from processes.h", NULL},
-        {"DeletePCB", "Deletes a PCB based on name given by user", "User input of the name of the PCB to be deleted"},
+        {"DeletePCB", "Deletes a PCB based on name or PID given by user", "User input of the name or PID of the PCB to be deleted"},
         {"BlockPCB", "Moves a PCB to the blocked state based on name given by user", "User input of the name of the PCB to be moved to blocked"},
         {"UnblockPCB", "Moves a PCB to the unblocked/ready state based on name given by user", "User input of the name of the PCB to be moved to unblocked/ready"},
-        {"SuspendPCB", "Moves a PCB to the suspended state based on name given by user", "User input of the name of the PCB to be moved to suspended"},
-        {"ResumePCB", "Moves a PCB out of the suspended state based on name given by user", "User input of the name of the PCB to be moved out of suspended"},
-        {"SetPriority", "Changes the priority of a PCB given by the user", "User input of the name of the PCB to change and the new priority (0-9)"},
-        {"ShowPCB", "Displays the PCB with the given name", "User input of the name of the PCB to display"},
+        {"SuspendPCB", "Moves a PCB to the suspended state based on name or PID given by user", "User input of the name or PID of the PCB to be moved to suspended"},
+        {"ResumePCB", "Moves a PCB out of the suspended state based on name or PID given by user", "User input of the name or PID of the PCB to be moved out of suspended"},
+        {"SetPriority", "Changes the priority of a PCB given by the user", "User input of the name or PID of the PCB to change and the new priority (0-9)"},
+        {"ShowPCB", "Displays the PCB with the given name or PID", "User input of the name or PID of the PCB to display"},
         {"ShowReady", "Displays all the PCBs currently in the ready queue", NULL},
         {"ShowBlocked", "Displays all the PCBs currently in the blocked queue", NULL},
         {"ShowAll", "Displays all the PCBs currently in the system", NULL},
+        {"StackUsage", "Displays the deepest each process's stack has grown, out of its full size", NULL},
+        {"SlabInfo", "Displays the size, slab count and allocation statistics of each kernel object cache", NULL},
+        {"Heap", "Runs the mem command: lists, allocates and frees heap blocks, shows heap statistics (-s) prints CSV samples for monitoring (-c) or profiles allocation sites (-p on, -p, -p off)", "mem options, such as '-s' or '-c 10 100' for ten samples 100 ticks apart"},
         //  Add any other commands here
         {NULL, NULL, NULL} // Sentinel to mark end of the array
 };
@@ -16,18 +16,13 @@ void (*process_funcs[])(void) = {proc1, proc2, proc3, proc4, proc5};
 
 void load_r3(void) {
     for (int i = 0; i < 5; i++) {
-        struct pcb *new_pcb = pcb_allocate();
+        struct pcb *new_pcb = pcb_setup(process_names[i], USER_PROCESS, 5);
         if (new_pcb == NULL) {
             char error_msg[] = "Error: Failed to allocate PCB for R3 process.\n";
             sys_req(WRITE, COM1, error_msg, strlen(error_msg));
             return;
         }
 
-        // copies process_names[i] (the source) into new_pcb->name (destination)
-        strncpy(new_pcb->name, process_names[i], sizeof(new_pcb->name));
-        new_pcb->priority = 5;
-        new_pcb->exec_state = READY;
-        new_pcb->disp_state = NOT_SUSPENDED;
         //new_pcb->stack_pointer = (struct context *)new_pcb->stack_pointer;
         struct context* new_context = (struct context*)new_pcb->stack_pointer;
         // Initialize the context / segment registers
@@ -1,18 +1,78 @@
-//#include <string.h>
-#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <memory.h>
+#include <memuser.h>
+#include <sys_req.h>
+#include <time_page.h>
+#include <mpx/ksyms.h>
 
 enum show { ALL, ALLOCATED, FREEBLOCKS };
 
+static void put(const char *s)
+{
+	sys_req(WRITE, COM1, s, strlen(s));
+}
+
+/* Formats an address as 0x followed by eight hex digits */
+static char *hex(uintptr_t v, char *buf)
+{
+	buf[0] = '0';
+	buf[1] = 'x';
+	for (int i = 9; i >= 2; i--, v >>= 4) {
+		buf[i] = "0123456789ABCDEF"[v & 0xF];
+	}
+	buf[10] = '\0';
+	return buf;
+}
+
+static uintptr_t htoi(const char *s)
+{
+	uintptr_t v = 0;
+
+	if (s[0] == '0' && (s[1] == 'x' || s[1] == 'X')) {
+		s += 2;
+	}
+	for (; *s; s++) {
+		if (*s >= '0' && *s <= '9') {
+			v = v * 16 + (*s - '0');
+		} else if (*s >= 'a' && *s <= 'f') {
+			v = v * 16 + (*s - 'a' + 10);
+		} else if (*s >= 'A' && *s <= 'F') {
+			v = v * 16 + (*s - 'A' + 10);
+		} else {
+			break;
+		}
+	}
+	return v;
+}
+
+/* Share of free memory outside the largest free block, in percent */
+static int fragmentation(const struct heap_stats *st)
+{
+	size_t free = st->free, largest = st->largest_free;
+
+	if (free == 0) {
+		return 0;
+	}
+	while (free > 0x1000000) {	// keep free * 100 within 32 bits
+		free >>= 1;
+		largest >>= 1;
+	}
+	return (int)((free - largest) * 100 / free);
+}
+
 static int mem_show(enum show which)
 {
+	char line[64], addr[11];
+
 	for (struct mcb *mcb = memlist; mcb != NULL; mcb = mcb_next(mcb)) {
 		if (which == ALL) {
-			printf("%s ", mcb_isfree(mcb) ? "FREE " : "ALLOC");
+			put(mcb_isfree(mcb) ? "FREE  " : "ALLOC ");
 		}
 		if (which == ALL || (which == ALLOCATED && !mcb_isfree(mcb)) || (which == FREEBLOCKS && mcb_isfree(mcb))) {
-			printf("%p: %zd\n", (void*)mcb->start, mcb_size(mcb));
+			sprintf(line, "%s: %d\n", hex((uintptr_t)mcb->start, addr), (int)mcb_size(mcb));
+			put(line);
 		}
 	}
 	return 0;
@@ -20,31 +80,138 @@ static int mem_show(enum show which)
 
 static int mem_alloc(int argc, char *argv[])
 {
+	char line[64], addr[11];
+
 	for (int i = 2; i < argc; i++) {
 		size_t sz = atoi(argv[i]);
 		void *ptr = allocate_memory(sz);
 		if (ptr == NULL) {
-			printf("Allocation of %zd bytes FAILED!\n", sz);
+			sprintf(line, "Allocation of %d bytes FAILED!\n", (int)sz);
+			put(line);
 			return 1;
 		}
-		printf("Allocated %zd at %p\n", sz, ptr);
+		sprintf(line, "Allocated %d at %s\n", (int)sz, hex((uintptr_t)ptr, addr));
+		put(line);
 	}
 	return 0;
 }
 
 static int mem_free(int argc, char *argv[])
 {
+	char line[64], addr[11];
+
 	for (int i = 2; i < argc; i++) {
 		void *ptr = (void*)htoi(argv[i]);
 		int ret = free_memory(ptr);
 		if (ret == -1) {
-			printf("Deallocating %p FAILED!\n", ptr);
+			sprintf(line, "Deallocating %s FAILED!\n", hex((uintptr_t)ptr, addr));
+			put(line);
 			return 1;
 		}
 	}
 	return 0;
 }
 
+static int mem_stats(void)
+{
+	struct heap_stats st;
+	char line[64];
+
+	if (heap_get_stats(&st) != 0) {
+		put("The MCB heap is not in use\n");
+		return 1;
+	}
+	sprintf(line, "Total:         %d bytes\n", (int)st.total);
+	put(line);
+	sprintf(line, "Allocated:     %d bytes\n", (int)st.allocated);
+	put(line);
+	sprintf(line, "Free:          %d bytes\n", (int)st.free);
+	put(line);
+	sprintf(line, "Largest free:  %d bytes\n", (int)st.largest_free);
+	put(line);
+	sprintf(line, "Free blocks:   %d\n", (int)st.free_blocks);
+	put(line);
+	sprintf(line, "Fragmentation: %d%%\n", fragmentation(&st));
+	put(line);
+	sprintf(line, "Allocs:        %d\n", (int)st.allocs);
+	put(line);
+	sprintf(line, "Frees:         %d\n", (int)st.frees);
+	put(line);
+	sprintf(line, "Peak usage:    %d bytes\n", (int)st.peak);
+	put(line);
+	return 0;
+}
+
+/* One CSV line per sample, interval ticks apart */
+static int mem_csv(int samples, int interval)
+{
+	struct heap_stats st;
+	char line[160];
+
+	if (samples < 1) {
+		samples = 1;
+	}
+	put("ticks,total,allocated,free,largest_free,free_blocks,frag_pct,allocs,frees,peak\n");
+	for (int i = 0; i < samples; i++) {
+		if (i > 0) {
+			sys_sleep(interval > 0 ? interval : 1);
+		}
+		if (heap_get_stats(&st) != 0) {
+			return 1;
+		}
+		sprintf(line, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%d\n",
+			(int)time_page_ticks(), (int)st.total, (int)st.allocated,
+			(int)st.free, (int)st.largest_free, (int)st.free_blocks,
+			fragmentation(&st), (int)st.allocs, (int)st.frees, (int)st.peak);
+		put(line);
+	}
+	return 0;
+}
+
+#define PROFILE_TOP 20
+
+/* Allocation sites with the most live bytes first */
+static int mem_profile(void)
+{
+	int count;
+	size_t dropped;
+	const struct heap_site *sites = heap_profile_sites(&count, &dropped);
+	char done[128] = { 0 };
+	char line[128], addr[11];
+
+	put("live_bytes blocks allocs pid  site\n");
+	for (int n = 0; n < PROFILE_TOP && n < count; n++) {
+		int best = -1;
+		for (int i = 0; i < count && i < (int)sizeof(done); i++) {
+			if (!done[i] && (best < 0 || sites[i].live_bytes > sites[best].live_bytes)) {
+				best = i;
+			}
+		}
+		if (best < 0) {
+			break;
+		}
+		done[best] = 1;
+
+		const struct heap_site *s = &sites[best];
+		uintptr_t off;
+		const char *sym = ksym_lookup((uintptr_t)s->caller, &off);
+		sprintf(line, "%d %d %d %d  ", (int)s->live_bytes, (int)s->live_blocks,
+			(int)s->allocs, s->owner);
+		put(line);
+		if (sym != NULL) {
+			sprintf(line, "%s+%s\n", sym, hex(off, addr));
+		} else {
+			sprintf(line, "%s\n", hex((uintptr_t)s->caller, addr));
+		}
+		put(line);
+	}
+	if (dropped) {
+		sprintf(line, "%d allocations did not fit in the profiler\n", (int)dropped);
+		put(line);
+	}
+	return 0;
+}
+
 int mem(int argc, char *argv[])
 {
 	if (argc < 2) {
@@ -57,12 +224,25 @@ int mem(int argc, char *argv[])
 		return mem_alloc(argc, argv);
 	} else if (!strcmp(argv[1], "-F")) {
 		return mem_free(argc, argv);
+	} else if (!strcmp(argv[1], "-s") && argc == 2) {
+		return mem_stats();
+	} else if (!strcmp(argv[1], "-p") && argc == 2) {
+		return mem_profile();
+	} else if (!strcmp(argv[1], "-p") && argc == 3 && (!strcmp(argv[2], "on") || !strcmp(argv[2], "off"))) {
+		heap_profile_enable(!strcmp(argv[2], "on"));
+		return 0;
+	} else if (!strcmp(argv[1], "-c") && argc <= 4) {
+		return mem_csv(argc > 2 ? atoi(argv[2]) : 1, argc > 3 ? atoi(argv[3]) : 0);
 	}
 
-	printf("\tmem               Show all memory blocks\n");
-	printf("\tmem -a            Show allocated memory\n");
-	printf("\tmem -f            Show free memory\n");
-	printf("\tmem -A size...    Allocate size bytes of memory\n");
-	printf("\tmem -F address... Free memory at address\n");
+	put("\tmem                Show all memory blocks\n");
+	put("\tmem -a             Show allocated memory\n");
+	put("\tmem -f             Show free memory\n");
+	put("\tmem -A size...     Allocate size bytes of memory\n");
+	put("\tmem -F address...  Free memory at address\n");
+	put("\tmem -s             Show heap statistics\n");
+	put("\tmem -c [n [ticks]] Print n CSV samples, ticks apart\n");
+	put("\tmem -p on|off      Start or stop recording allocation sites\n");
+	put("\tmem -p             Show allocation sites by live bytes\n");
 	return 1;
 }
@@ -0,0 +1,55 @@
+#include "memuser.h"
+#include <mpx/slab.h>
+#include <string.h>
+#include <stdlib.h>
+#include <sys_req.h>
+
+// Shows the statistics of every kernel object cache
+void slab_info(void) {
+    char header[] = "\n====== OBJECT CACHES ======\n";
+    sys_req(WRITE, COM1, header, strlen(header));
+
+    struct kmem_cache *cache = kmem_cache_list();
+    if (cache == NULL) {
+        char none[] = "No caches have been created.\n";
+        sys_req(WRITE, COM1, none, strlen(none));
+        return;
+    }
+
+    char output[300];
+    for (; cache != NULL; cache = cache->next) {
+        sprintf(output, "Name: %s\nObject Size: %d\nObjects/Slab: %d\nSlabs: %d\nIn Use: %d / %d\n",
+                cache->name, (int)cache->size, (int)cache->per_slab, (int)cache->nslabs,
+                (int)cache->in_use, (int)(cache->nslabs * cache->per_slab));
+        sys_req(WRITE, COM1, output, strlen(output));
+        sprintf(output, "Allocs: %d\nFrees: %d\nSlab Grows: %d\nFailures: %d\n\n",
+                (int)cache->allocs, (int)cache->frees, (int)cache->grows, (int)cache->failures);
+        sys_req(WRITE, COM1, output, strlen(output));
+    }
+}
+
+#define MEM_MAX_ARGS 8
+
+// Reads mem options from the user and runs mem() with them
+void heap_command(void) {
+    char prompt[] = "\nmem options (-h for help): ";
+    sys_req(WRITE, COM1, prompt, strlen(prompt));
+
+    char line[100] = {0};
+    int userIn = sys_req(READ, COM1, line, sizeof(line) - 1);
+    if (userIn < 0) {
+        userIn = 0;
+    }
+    line[userIn] = '\0'; // Null-terminate
+    while (userIn > 0 && (line[userIn-1] == '\n' || line[userIn-1] == '\r')) {
+        line[--userIn] = '\0';
+    }
+
+    char name[] = "mem";
+    char *argv[MEM_MAX_ARGS] = { name };
+    int argc = 1;
+    for (char *tok = strtok(line, " "); tok != NULL && argc < MEM_MAX_ARGS; tok = strtok(NULL, " ")) {
+        argv[argc++] = tok;
+    }
+    mem(argc, argv);
+}
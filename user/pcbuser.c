@@ -1,12 +1,29 @@
 #include "pcbuser.h"
 #include "pcb.h"
 #include "time.h"
+#include "sys_call.h"
+#include <mpx/stack.h>
 #include <string.h>
 #include <sys_req.h>
 #include <stdlib.h>
 #include <mpx/serial.h>
 
 
+// Finds a PCB by PID if the input is all digits, otherwise by name. An
+// all-digit name is still found when no process has that PID.
+static struct pcb *find_target(const char *input) {
+    const char *c = input;
+    while (*c >= '0' && *c <= '9') {
+        c++;
+    }
+    if (c != input && *c == '\0') {
+        struct pcb *found = pcb_find_pid(atoi(input));
+        if (found != NULL) {
+            return found;
+        }
+    }
+    return pcb_find(input);
+}
 
 void create_pcb(void) {
     char name[50] = {0};
@@ -103,8 +120,8 @@ void create_pcb(void) {
 void delete_pcb(void) {
     char name[50] = {0};
 
-    // Prompts user for PCB name
-    char askForName[] = "\nPlease enter the PCB name: ";
+    // Prompts user for PCB name or PID
+    char askForName[] = "\nPlease enter the PCB name or PID: ";
     sys_req(WRITE, COM1, askForName, strlen(askForName));
 
     // Reads in user response
@@ -114,11 +131,11 @@ void delete_pcb(void) {
         name[--userIn] = '\0';
     }
 
-    struct pcb *targetPCB = pcb_find(name);
+    struct pcb *targetPCB = find_target(name);
 
     // Checks to see if the name exists
     if (!targetPCB) {
-        char nameMsg[] = "\033[0;31mName entered does not exist.\n";
+        char nameMsg[] = "\033[0;31mName or PID entered does not exist.\n";
         sys_req(WRITE, COM1, nameMsg, strlen(nameMsg));
         return;
     }
@@ -131,6 +148,7 @@ void delete_pcb(void) {
     }
 
     // Remove the PCB and free associated memory
+    strcpy(name, targetPCB->name); // Report the name even if a PID was entered
     pcb_remove(targetPCB);
     pcb_free(targetPCB);
 
@@ -220,8 +238,8 @@ void delete_pcb(void) {
 void suspend_pcb(void) {
     char name[50] = {0};
 
-    // Prompts user for PCB name
-    char askForName[] = "\nPlease enter the PCB name: ";
+    // Prompts user for PCB name or PID
+    char askForName[] = "\nPlease enter the PCB name or PID: ";
     sys_req(WRITE, COM1, askForName, strlen(askForName));
 
     // Reads in user response
@@ -232,20 +250,20 @@ void suspend_pcb(void) {
     }
 
     // Checks if the PCB exists
-    if(pcb_find(name) == NULL) {
-        char nameMsg[] = "\033[0;31mName entered does not exist.\n";
+    struct pcb* suspend_pcb = find_target(name);
+    if(suspend_pcb == NULL) {
+        char nameMsg[] = "\033[0;31mName or PID entered does not exist.\n";
         sys_req(WRITE, COM1, nameMsg, strlen(nameMsg));
         return;
     }
         // Check if the process is a system process
-    else if(pcb_find(name)->class == 1) {
+    else if(suspend_pcb->class == 1) {
         char sysMsg[] = "\033[0;31mA system process can't be suspended.\n";
         sys_req(WRITE, COM1, sysMsg, strlen(sysMsg));
         return;
     }
     else {
-        // Find the PCB and remove it from current queue
-        struct pcb* suspend_pcb = pcb_find(name);
+        // Remove the PCB from its current queue
         pcb_remove(suspend_pcb);
 
         // Changes disp_state to suspended
@@ -257,7 +275,7 @@ void suspend_pcb(void) {
 
     // Notify user of the suspension
     char successMsg[100];
-    sprintf(successMsg, "\nPCB %s has been suspended successfully.\n", name);
+    sprintf(successMsg, "\nPCB %s has been suspended successfully.\n", suspend_pcb->name);
     sys_req(WRITE, COM1, successMsg, strlen(successMsg));
 }
 
@@ -266,7 +284,7 @@ void resume_pcb(void) {
     char name[50] = {0};
 
     // Prompts user for PCB name
-    char askForRName[] = "\nPlease enter the PCB name you wish to resume: ";
+    char askForRName[] = "\nPlease enter the name or PID of the PCB you wish to resume: ";
     sys_req(WRITE, COM1, askForRName, strlen(askForRName));
 
     // Reads in user response
@@ -277,9 +295,9 @@ void resume_pcb(void) {
     }
 
     // Checks if the PCB exists
-    struct pcb* resume_pcb = pcb_find(name);
+    struct pcb* resume_pcb = find_target(name);
     if (resume_pcb == NULL) {
-        char nameMsg[] = "\033[0;31mName entered does not exist.\n";
+        char nameMsg[] = "\033[0;31mName or PID entered does not exist.\n";
         sys_req(WRITE, COM1, nameMsg, strlen(nameMsg));
         return;
     }
@@ -302,7 +320,7 @@ void resume_pcb(void) {
 
     // Notify user of the resuming
     char successMsg[100];
-    sprintf(successMsg, "\nPCB %s has been resumed successfully.\n", name);
+    sprintf(successMsg, "\nPCB %s has been resumed successfully.\n", resume_pcb->name);
     sys_req(WRITE, COM1, successMsg, strlen(successMsg));
 }
 
@@ -313,7 +331,7 @@ void set_priority(void) {
     int priority = 0;
 
     // Prompts user for PCB name
-    char askForName[] = "Please enter the PCB you wish to set priority for: ";
+    char askForName[] = "Please enter the name or PID of the PCB you wish to set priority for: ";
     sys_req(WRITE, COM1, askForName, strlen(askForName));
 
     // Reads in user response for name
@@ -321,9 +339,9 @@ void set_priority(void) {
     sys_req(WRITE, COM1, name, userIn);
 
     // Checks if the PCB exists
-    struct pcb* targetPCB = pcb_find(name);
+    struct pcb* targetPCB = find_target(name);
     if (targetPCB == NULL) {
-        char nameMsg[] = "\033[0;31mName entered does not exist.\n";
+        char nameMsg[] = "\033[0;31mName or PID entered does not exist.\n";
         sys_req(WRITE, COM1, nameMsg, strlen(nameMsg));
         return;
     }
@@ -358,7 +376,7 @@ void set_priority(void) {
 
     // Updated success message to display the PCB name and its priority
     char successMsg[100];
-    sprintf(successMsg, "Priority for PCB '%s' successfully set to %d.\n", name, priority);
+    sprintf(successMsg, "Priority for PCB '%s' successfully set to %d.\n", targetPCB->name, priority);
     sys_req(WRITE, COM1, successMsg, strlen(successMsg));
 }
 
@@ -367,18 +385,18 @@ void show_pcb(void) {
     char name[50] = {0};
 
     // Prompts user for PCB name
-    char askForName[] = "Please enter the PCB name: ";
+    char askForName[] = "Please enter the PCB name or PID: ";
     sys_req(WRITE, COM1, askForName, strlen(askForName));
 
     // Reads in user response
     int userIn = sys_req(READ, COM1, name, sizeof(name) - 1);
     sys_req(WRITE, COM1, name, userIn);
 
-    struct pcb *showtarget = pcb_find(name);
+    struct pcb *showtarget = find_target(name);
 
     // Checks if the PCB exists
     if(showtarget == NULL) {
-        char nameMsg[] = "\033[0;31mName entered does not exist.\n";
+        char nameMsg[] = "\033[0;31mName or PID entered does not exist.\n";
         sys_req(WRITE, COM1, nameMsg, strlen(nameMsg));
         return;
     }
@@ -412,8 +430,9 @@ void show_pcb(void) {
     }
 
     char output[500];
-    sprintf(output, "Name: %s\nClass: %s\nState: %s\nSuspended Status: %s\nPriority: %s\n",
-            name, class_string, exestate_string, suspension_string, priority_string);
+    sprintf(output, "Name: %s\nPID: %d\nClass: %s\nState: %s\nSuspended Status: %s\nPriority: %s\nStack Used: %d of %d bytes\n",
+            showtarget->name, showtarget->pid, class_string, exestate_string, suspension_string, priority_string,
+            (int)stack_usage(showtarget->stack), STACK_SIZE);
     sys_req(WRITE, COM1, output, strlen(output));
 }
 
@@ -438,8 +457,9 @@ void display_pcb(struct pcb *target) {
     strcpy(suspension_string, target->disp_state == NOT_SUSPENDED ? "NOT_SUSPENDED" : "SUSPENDED");
 
     char output[500];
-    sprintf(output, "Name: %s\nClass: %s\nState: %s\nSuspended Status: %s\nPriority: %s\n",
-            target->name, class_string, exestate_string, suspension_string, priority_string);
+    sprintf(output, "Name: %s\nPID: %d\nClass: %s\nState: %s\nSuspended Status: %s\nPriority: %s\nStack Used: %d of %d bytes\n",
+            target->name, target->pid, class_string, exestate_string, suspension_string, priority_string,
+            (int)stack_usage(target->stack), STACK_SIZE);
     sys_req(WRITE, COM1, output, strlen(output));
 }
 
@@ -494,5 +514,29 @@ void show_all(void) {
     show_blocked();
 }
 
+// Writes one line of the stack usage table
+static void stack_usage_line(struct pcb *pcb) {
+    int used = (int)stack_usage(pcb->stack);
+    char output[100];
+    sprintf(output, "%s: %d of %d bytes (%d%%)\n", pcb->name, used, STACK_SIZE, used * 100 / STACK_SIZE);
+    sys_req(WRITE, COM1, output, strlen(output));
+}
 
+// Shows the peak stack depth of every process
+void stack_usage_all(void) {
+    char header[] = "\n====== STACK USAGE ======\n";
+    sys_req(WRITE, COM1, header, strlen(header));
 
+    if (current_pcb) {
+        stack_usage_line(current_pcb); // Not in a queue while it runs
+    }
+    for (struct pcb *current = ReadyQueue; current; current = current->next) {
+        stack_usage_line(current);
+    }
+    for (struct pcb *current = BlockedQueue; current; current = current->next) {
+        stack_usage_line(current);
+    }
+
+    char footer[] = "=========================\n\n";
+    sys_req(WRITE, COM1, footer, strlen(footer));
+}
@@ -9,6 +9,8 @@
 #include <stdlib.h>
 #include <stdint.h>
 #include <sys_req.h>
+#include <sys_ring.h>
+#include <time_page.h>
 #include <string.h>
 #include "time.h"
 
@@ -42,16 +44,12 @@ int bcdToDecimal(int bcd) {
 void get_time(void) {
     int seconds,minutes, hours;
 
-    // Disable interrupts
-    cli();
-
-    // Read seconds, minutes, and hours from RTC registers
-    seconds = bcdToDecimal(readRTC(RTC_SECONDS_REG));
-    minutes = bcdToDecimal(readRTC(RTC_MINUTES_REG));
-    hours = bcdToDecimal(readRTC(RTC_HOURS_REG));
-
-    // Enable interrupts
-    sti();
+    // Read seconds, minutes, and hours from the kernel time page
+    struct time_page now;
+    time_page_read(&now);
+    seconds = now.seconds;
+    minutes = now.minutes;
+    hours = now.hours;
 
     // Display the current time
     char time_msg[] = "\n Current time \nUpdated on September 10th, 2023\n";
@@ -70,21 +68,25 @@ void get_time(void) {
     itoa(hours, hours_string,10);
 
 
-    //sys_req(WRITE, COM1, time_msg, hours_string, minutes_string, seconds_string);
-    sys_req(WRITE, COM1, time_msg, strlen(time_msg));
+    // Queue every piece of the message and hand them to the kernel in one trap
+    // (the write counts left in the completion queue are dropped on the next init)
+    static struct sys_ring ring;
+    sys_ring_init(&ring);
+    sys_ring_write(&ring, COM1, time_msg, strlen(time_msg));
     // break for hours
-    sys_req(WRITE, COM1, hours_msg, strlen(hours_msg));
-    sys_req(WRITE, COM1, hours_string, strlen(hours_string));
+    sys_ring_write(&ring, COM1, hours_msg, strlen(hours_msg));
+    sys_ring_write(&ring, COM1, hours_string, strlen(hours_string));
     // break for minutes
-    sys_req(WRITE, COM1, min_msg, strlen(min_msg));
-    sys_req(WRITE, COM1, minutes_string, strlen(minutes_string));
+    sys_ring_write(&ring, COM1, min_msg, strlen(min_msg));
+    sys_ring_write(&ring, COM1, minutes_string, strlen(minutes_string));
 
     // break for seconds
-    sys_req(WRITE, COM1, sec_msg, strlen(sec_msg));
-    sys_req(WRITE, COM1, seconds_string, strlen(seconds_string));
+    sys_ring_write(&ring, COM1, sec_msg, strlen(sec_msg));
+    sys_ring_write(&ring, COM1, seconds_string, strlen(seconds_string));
 
-    sys_req(WRITE, COM1, UTC_space, strlen(UTC_space));
-    sys_req(WRITE, COM1, "\n\n", strlen("\n\n"));
+    sys_ring_write(&ring, COM1, UTC_space, strlen(UTC_space));
+    sys_ring_write(&ring, COM1, "\n\n", strlen("\n\n"));
+    sys_ring_submit(&ring);
 
 }
 
@@ -162,14 +164,16 @@ void getDate(void){
 	int day;
 	int month;
 	int year;
-	char* day_s = "";
-	char* month_s = "";
-	char* year_s = "";
+	char day_s[4] = {0};
+	char month_s[4] = {0};
+	char year_s[4] = {0};
+
+	// Read the date from the kernel time page
+	struct time_page now;
+	time_page_read(&now);
 
 	// Displaying the month
-	outb(RTC_INDEX_PORT, MONTH);
-	char temp = inb(0x71);
-	month = ((temp >> 4) &0x0f) * 10 + (temp &0x0f);
+	month = now.month;
 
 	// Checks if Month is a single digit if so add a leading 0
 	if(month < 10){
@@ -181,9 +185,7 @@ void getDate(void){
 	sys_req(WRITE, COM1, "/", strlen("/"));
 
 	// Displaying the day
-	outb(RTC_INDEX_PORT, DAY);
-	temp = inb(0x71);
-	day = ((temp >> 4) &0x0f) * 10 + (temp &0x0f);
+	day = now.day;
 
 	// Checks if Date is a single digit if so add a leading 0
 	if(day < 10){
@@ -195,9 +197,7 @@ void getDate(void){
 	sys_req(WRITE, COM1, "/", strlen("/"));
 
 	// Displaying the year
-	outb(RTC_INDEX_PORT, YEAR);
-	temp = inb(0x71);
-	year = ((temp >> 4) &0x0f) * 10 + (temp &0x0f);
+	year = now.year;
 
 	// Checks if Year is a single digit if so add a leading 0
 	if(year < 10){